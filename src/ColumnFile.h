@@ -0,0 +1,445 @@
+/*
+**
+* BEGIN_COPYRIGHT
+*
+* Copyright (C) 2008-2016 SciDB, Inc.
+* All Rights Reserved.
+*
+* Pull is a plugin for SciDB, an Open Source Array DBMS maintained
+* by Paradigm4. See http://www.paradigm4.com/
+*
+* Pull is free software: you can redistribute it and/or modify
+* it under the terms of the AFFERO GNU General Public License as published by
+* the Free Software Foundation.
+*
+* summarize is distributed "AS-IS" AND WITHOUT ANY WARRANTY OF ANY KIND,
+* INCLUDING ANY IMPLIED WARRANTY OF MERCHANTABILITY,
+* NON-INFRINGEMENT, OR FITNESS FOR A PARTICULAR PURPOSE. See
+* the AFFERO GNU General Public License for the complete license terms.
+*
+* You should have received a copy of the AFFERO GNU General Public License
+* along with summarize.  If not, see <http://www.gnu.org/licenses/agpl-3.0.html>
+*
+* END_COPYRIGHT
+*/
+
+#ifndef COLUMN_FILE
+#define COLUMN_FILE
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "PullSettings.h"
+#include "PullSinks.h"
+
+namespace scidb
+{
+namespace pull
+{
+
+/*
+ * The file sink=file:<path> writes, one per instance. All integers are little-endian.
+ *
+ *   header    COLUMN_FILE_MAGIC, version, number of attributes, number of dimensions, then every
+ *             attribute's name and type and every dimension's name, each NUL-terminated; padded
+ *             to COLUMN_FILE_ALIGNMENT
+ *   blocks    each holds chunk payloads of a single attribute, 8-byte aligned within the block;
+ *             blocks start and end on COLUMN_FILE_ALIGNMENT
+ *   index     one ColumnIndexEntry followed by its numDims chunk coordinates per chunk, sorted by
+ *             attribute, then by position
+ *   trailer   ColumnFileTrailer, the last bytes of the file
+ *
+ * A reader maps the file, reads the trailer, and finds every chunk's payload through the index.
+ */
+static const uint64_t COLUMN_FILE_MAGIC     = 0x314c4f434c4c5550ULL;   //"PULLCOL1"
+static const uint32_t COLUMN_FILE_VERSION   = 1;
+static const size_t   COLUMN_FILE_ALIGNMENT = 4096;
+
+struct ColumnFileHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t numAttributes;
+    uint32_t numDims;
+    uint32_t reserved;
+};
+
+struct ColumnIndexEntry
+{
+    uint32_t att;
+    uint32_t reserved;
+    uint64_t offset;            //of the payload, from the start of the file
+    uint64_t size;
+};
+
+struct ColumnFileTrailer
+{
+    uint64_t indexOffset;
+    uint64_t numEntries;
+    uint64_t magic;
+};
+
+/*
+ * Streams chunk payloads into a column file. Every attribute fills a staging block of its own;
+ * a full block goes to the file in one aligned write, optionally with O_DIRECT, so the file ends
+ * up as runs of single-attribute blocks. Chunks only learn their offset once their block is
+ * written. finish() adds the index and the trailer and fsyncs; a writer destroyed without it
+ * leaves a file with no index.
+ */
+class ColumnFileWriter : public SinkTarget
+{
+private:
+    static const size_t BLOCK_SIZE = 8 * 1024 * 1024;
+
+    struct PendingChunk
+    {
+        AttributeID att;
+        Coordinates position;
+        uint64_t    offset;     //within the staging block until the block is written
+        uint64_t    size;
+
+        bool operator<(PendingChunk const& other) const
+        {
+            return att != other.att ? att < other.att : position < other.position;
+        }
+    };
+
+    string                                 _path;
+    size_t const                           _numDims;
+    int                                    _fd;
+    vector<std::unique_ptr<AlignedBuffer> > _staging;
+    vector<std::unique_ptr<AlignedBuffer> > _spareBlocks;   //written out, ready to stage again
+    vector<size_t>                         _stagingUsed;
+    vector<vector<size_t> >                _stagingChunks;  //indexes into _chunks
+    vector<PendingChunk>                   _chunks;
+    uint64_t                               _fileSize;
+    uint64_t                               _bytesWritten;
+    double                                 _writeSeconds;
+    size_t                                 _writesInFlight;
+    std::chrono::steady_clock::time_point  _busySince;
+    double                                 _fsyncSeconds;
+    std::mutex                             _mutex;
+
+    ColumnFileWriter(ColumnFileWriter const&);
+    ColumnFileWriter& operator=(ColumnFileWriter const&);
+
+    static size_t alignUp(size_t const size, size_t const alignment)
+    {
+        return ((size + alignment - 1) / alignment) * alignment;
+    }
+
+    static double secondsSince(std::chrono::steady_clock::time_point const& start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /*
+     * Write size bytes at offset, zero-padded to the alignment. data must have room for the
+     * padding. Every extent is claimed by one caller, so this runs without the lock.
+     */
+    void writeExtent(char* data, size_t const size, uint64_t const offset)
+    {
+        size_t const padded = alignUp(size, COLUMN_FILE_ALIGNMENT);
+        memset(data + size, 0, padded - size);
+        size_t done = 0;
+        while(done < padded)
+        {
+            ssize_t const written = pwrite(_fd, data + done, padded - done, offset + done);
+            if(written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if(written <= 0)
+            {
+                ostringstream error;
+                error<<"write to "<<_path<<" failed: "<<strerror(errno);
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+            }
+            done += written;
+        }
+    }
+
+    /*
+     * Claim the next size bytes of the file, padded, and mark a write in flight. Under the lock.
+     */
+    uint64_t claimExtent(size_t const size)
+    {
+        uint64_t const offset = _fileSize;
+        size_t const padded = alignUp(size, COLUMN_FILE_ALIGNMENT);
+        _fileSize     += padded;
+        _bytesWritten += padded;
+        if(_writesInFlight++ == 0)
+        {
+            _busySince = std::chrono::steady_clock::now();
+        }
+        return offset;
+    }
+
+    /*
+     * A claimed extent has been written. The write time is the time any write was in flight, so
+     * writes that overlap aren't counted twice. Under the lock.
+     */
+    void extentWritten()
+    {
+        if(--_writesInFlight == 0)
+        {
+            _writeSeconds += secondsSince(_busySince);
+        }
+    }
+
+    /*
+     * Take the attribute's staged block for writing at a freshly claimed offset, and give the
+     * attribute an empty one. Under the lock.
+     */
+    std::unique_ptr<AlignedBuffer> takeBlock(AttributeID const att, size_t& size, uint64_t& offset)
+    {
+        size   = _stagingUsed[att];
+        offset = claimExtent(size);
+        for(size_t c = 0; c<_stagingChunks[att].size(); ++c)
+        {
+            _chunks[_stagingChunks[att][c]].offset += offset;
+        }
+        _stagingChunks[att].clear();
+        _stagingUsed[att] = 0;
+        std::unique_ptr<AlignedBuffer> block = std::move(_staging[att]);
+        if(_spareBlocks.empty())
+        {
+            _staging[att].reset(new AlignedBuffer());
+        }
+        else
+        {
+            _staging[att] = std::move(_spareBlocks.back());
+            _spareBlocks.pop_back();
+        }
+        return block;
+    }
+
+    void writeHeader(ArrayDesc const& inputSchema)
+    {
+        Attributes const& attributes = inputSchema.getAttributes();
+        Dimensions const& dimensions = inputSchema.getDimensions();
+        ColumnFileHeader header;
+        header.magic         = COLUMN_FILE_MAGIC;
+        header.version       = COLUMN_FILE_VERSION;
+        header.numAttributes = attributes.size();
+        header.numDims       = dimensions.size();
+        header.reserved      = 0;
+        string names;
+        for(size_t a = 0; a<attributes.size(); ++a)
+        {
+            names += attributes[a].getName();
+            names.push_back('\0');
+            names += attributes[a].getType();
+            names.push_back('\0');
+        }
+        for(size_t d = 0; d<dimensions.size(); ++d)
+        {
+            names += dimensions[d].getBaseName();
+            names.push_back('\0');
+        }
+        AlignedBuffer buffer;
+        size_t const size = sizeof(header) + names.size();
+        char* const out = buffer.reserve(alignUp(size, COLUMN_FILE_ALIGNMENT));
+        memcpy(out, &header, sizeof(header));
+        memcpy(out + sizeof(header), names.data(), names.size());
+        writeExtent(out, size, claimExtent(size));
+        extentWritten();
+    }
+
+public:
+    /*
+     * Create or truncate the file at path. With direct, it is opened O_DIRECT where the file
+     * system allows.
+     */
+    ColumnFileWriter(string const& path, ArrayDesc const& inputSchema, bool const direct):
+        _path(path),
+        _numDims(inputSchema.getDimensions().size()),
+        _fd(-1),
+        _stagingUsed(inputSchema.getAttributes().size(), 0),
+        _stagingChunks(inputSchema.getAttributes().size()),
+        _fileSize(0),
+        _bytesWritten(0),
+        _writeSeconds(0),
+        _writesInFlight(0),
+        _fsyncSeconds(-1)
+    {
+        int const flags = O_WRONLY | O_CREAT | O_TRUNC;
+        if(direct)
+        {
+            _fd = open(_path.c_str(), flags | O_DIRECT, 0644);
+            if(_fd < 0 && errno == EINVAL)
+            {
+                LOG4CXX_WARN(logger, "pull: " << _path << " doesn't support O_DIRECT; writing it through the page cache");
+            }
+        }
+        if(_fd < 0)
+        {
+            _fd = open(_path.c_str(), flags, 0644);
+        }
+        if(_fd < 0)
+        {
+            ostringstream error;
+            error<<"can't create "<<_path<<": "<<strerror(errno);
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+        }
+        for(size_t a = 0; a<_stagingUsed.size(); ++a)
+        {
+            _staging.push_back(std::unique_ptr<AlignedBuffer>(new AlignedBuffer()));
+        }
+        writeHeader(inputSchema);
+    }
+
+    virtual ~ColumnFileWriter()
+    {
+        if(_fd >= 0)
+        {
+            close(_fd);
+        }
+    }
+
+    /*
+     * Stage one chunk. When it doesn't fit in the attribute's block, the full block is taken out
+     * under the lock and written after the lock is released, so other workers keep staging
+     * meanwhile. The wait reported is for the lock and for writing out that block.
+     */
+    virtual double write(AttributeID const att, Coordinates const& position, void const* payload, uint64_t const payloadSize)
+    {
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+        std::unique_ptr<AlignedBuffer> full;
+        size_t fullSize = 0;
+        uint64_t fullOffset = 0;
+        double stall;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            stall = secondsSince(start);
+            size_t const recordSize = alignUp(payloadSize, sizeof(uint64_t));
+            if(_stagingUsed[att] > 0 && _stagingUsed[att] + recordSize > BLOCK_SIZE)
+            {
+                full = takeBlock(att, fullSize, fullOffset);
+            }
+            stage(att, position, payload, payloadSize, recordSize);
+        }
+        if(full)
+        {
+            std::chrono::steady_clock::time_point const writeStart = std::chrono::steady_clock::now();
+            writeExtent(full->data(), fullSize, fullOffset);
+            stall += secondsSince(writeStart);
+            std::lock_guard<std::mutex> lock(_mutex);
+            extentWritten();
+            _spareBlocks.push_back(std::move(full));
+        }
+        return stall;
+    }
+
+    /*
+     * Write out the partial blocks, the index and the trailer, trim the padding after the
+     * trailer, and fsync. Every worker must be done writing.
+     */
+    void finish()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for(AttributeID att = 0; att<_staging.size(); ++att)
+        {
+            if(_stagingUsed[att] > 0)
+            {
+                size_t size;
+                uint64_t offset;
+                std::unique_ptr<AlignedBuffer> block = takeBlock(att, size, offset);
+                writeExtent(block->data(), size, offset);
+                extentWritten();
+            }
+        }
+        finishIndex();
+    }
+
+private:
+    void stage(AttributeID const att, Coordinates const& position, void const* payload, uint64_t const payloadSize, size_t const recordSize)
+    {
+        size_t const used = _stagingUsed[att];
+        //a chunk larger than a block gets a block of its own
+        char* const block = _staging[att]->reserve(alignUp(std::max((size_t) BLOCK_SIZE, used + recordSize), COLUMN_FILE_ALIGNMENT), used);
+        memcpy(block + used, payload, payloadSize);
+        memset(block + used + payloadSize, 0, recordSize - payloadSize);
+        PendingChunk chunk;
+        chunk.att      = att;
+        chunk.position = position;
+        chunk.offset   = used;
+        chunk.size     = payloadSize;
+        _stagingChunks[att].push_back(_chunks.size());
+        _chunks.push_back(chunk);
+        _stagingUsed[att] = used + recordSize;
+    }
+
+    void finishIndex()
+    {
+        std::sort(_chunks.begin(), _chunks.end());
+        size_t const entrySize = sizeof(ColumnIndexEntry) + _numDims * sizeof(int64_t);
+        size_t const footerSize = _chunks.size() * entrySize + sizeof(ColumnFileTrailer);
+        AlignedBuffer buffer;
+        char* out = buffer.reserve(alignUp(footerSize, COLUMN_FILE_ALIGNMENT));
+        for(size_t c = 0; c<_chunks.size(); ++c)
+        {
+            ColumnIndexEntry entry;
+            entry.att      = _chunks[c].att;
+            entry.reserved = 0;
+            entry.offset   = _chunks[c].offset;
+            entry.size     = _chunks[c].size;
+            memcpy(out, &entry, sizeof(entry));
+            memcpy(out + sizeof(entry), &_chunks[c].position[0], _numDims * sizeof(int64_t));
+            out += entrySize;
+        }
+        ColumnFileTrailer trailer;
+        trailer.indexOffset = _fileSize;
+        trailer.numEntries  = _chunks.size();
+        trailer.magic       = COLUMN_FILE_MAGIC;
+        memcpy(out, &trailer, sizeof(trailer));
+        uint64_t const fileEnd = _fileSize + footerSize;
+        writeExtent(buffer.data(), footerSize, claimExtent(footerSize));
+        extentWritten();
+        std::chrono::steady_clock::time_point const syncStart = std::chrono::steady_clock::now();
+        if(ftruncate(_fd, fileEnd) != 0 || fsync(_fd) != 0)
+        {
+            ostringstream error;
+            error<<"can't sync "<<_path<<": "<<strerror(errno);
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+        }
+        _fsyncSeconds = secondsSince(syncStart);
+        close(_fd);
+        _fd = -1;
+    }
+
+public:
+    /*
+     * Bytes handed to the file system, padding included.
+     */
+    uint64_t bytesWritten() const
+    {
+        return _bytesWritten;
+    }
+
+    double writeSeconds() const
+    {
+        return _writeSeconds;
+    }
+
+    /*
+     * Negative until finish() has run.
+     */
+    double fsyncSeconds() const
+    {
+        return _fsyncSeconds;
+    }
+};
+
+} } //namespaces
+
+#endif //column_file
@@ -0,0 +1,214 @@
+/*
+**
+* BEGIN_COPYRIGHT
+*
+* Copyright (C) 2008-2016 SciDB, Inc.
+* All Rights Reserved.
+*
+* Pull is a plugin for SciDB, an Open Source Array DBMS maintained
+* by Paradigm4. See http://www.paradigm4.com/
+*
+* Pull is free software: you can redistribute it and/or modify
+* it under the terms of the AFFERO GNU General Public License as published by
+* the Free Software Foundation.
+*
+* summarize is distributed "AS-IS" AND WITHOUT ANY WARRANTY OF ANY KIND,
+* INCLUDING ANY IMPLIED WARRANTY OF MERCHANTABILITY,
+* NON-INFRINGEMENT, OR FITNESS FOR A PARTICULAR PURPOSE. See
+* the AFFERO GNU General Public License for the complete license terms.
+*
+* You should have received a copy of the AFFERO GNU General Public License
+* along with summarize.  If not, see <http://www.gnu.org/licenses/agpl-3.0.html>
+*
+* END_COPYRIGHT
+*/
+
+#ifndef LATENCY_HISTOGRAM
+#define LATENCY_HISTOGRAM
+
+#include <algorithm>
+#include <limits>
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+namespace scidb
+{
+namespace pull
+{
+
+/*
+ * Log-bucketed latency histogram in the style of HdrHistogram. Values are nanoseconds. Below
+ * SUB_BUCKETS every value has a bucket of its own; above that, each power of two is cut into
+ * SUB_BUCKETS equal buckets, so any recorded value is known to within 1/SUB_BUCKETS (~6%).
+ * The exact min and max are kept on the side. Two histograms merge by adding counts, which is
+ * what lets per-thread and per-instance histograms be combined without losing the tail.
+ */
+class LatencyHistogram
+{
+private:
+    static const uint64_t SUB_BUCKET_BITS = 4;
+    static const uint64_t SUB_BUCKETS     = 1 << SUB_BUCKET_BITS;
+    static const uint64_t MAX_EXPONENT    = 43;   //2^44 ns is almost 5 hours; slower chunks land in the last bucket
+    static const size_t   NUM_BUCKETS     = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    std::vector<uint64_t> _counts;
+    uint64_t         _count;
+    uint64_t         _min;
+    uint64_t         _max;
+
+    static uint64_t highestBit(uint64_t v)
+    {
+        return 63 - __builtin_clzll(v);
+    }
+
+    static size_t bucketOf(uint64_t nanos)
+    {
+        if(nanos < SUB_BUCKETS)
+        {
+            return nanos;
+        }
+        uint64_t const exponent = highestBit(nanos);
+        if(exponent > MAX_EXPONENT)
+        {
+            return NUM_BUCKETS - 1;
+        }
+        uint64_t const sub = (nanos >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+        return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+    }
+
+    /*
+     * The largest value that falls into the bucket.
+     */
+    static uint64_t bucketHighestValue(size_t bucket)
+    {
+        if(bucket < SUB_BUCKETS)
+        {
+            return bucket;
+        }
+        uint64_t const exponent = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+        uint64_t const sub      = bucket % SUB_BUCKETS;
+        uint64_t const width    = ((uint64_t) 1) << (exponent - SUB_BUCKET_BITS);
+        return (SUB_BUCKETS + sub) * width + width - 1;
+    }
+
+public:
+    /*
+     * The histogram's wire form is a header of POD_HEADER_WORDS 8-byte words followed by the
+     * counts of the non-empty bucket range only, so a handful of chunks costs a handful of words.
+     */
+    static const size_t POD_HEADER_WORDS = 5;
+    static const size_t MAX_POD_WORDS    = POD_HEADER_WORDS + NUM_BUCKETS;
+
+    LatencyHistogram():
+        _counts(NUM_BUCKETS, 0),
+        _count(0),
+        _min(std::numeric_limits<uint64_t>::max()),
+        _max(0)
+    {}
+
+    void record(double seconds)
+    {
+        uint64_t const nanos = seconds <= 0 ? 0 : (uint64_t) (seconds * 1.0e9);
+        ++_counts[bucketOf(nanos)];
+        ++_count;
+        _min = std::min(_min, nanos);
+        _max = std::max(_max, nanos);
+    }
+
+    void merge(LatencyHistogram const& other)
+    {
+        for(size_t b = 0; b<NUM_BUCKETS; ++b)
+        {
+            _counts[b] += other._counts[b];
+        }
+        _count += other._count;
+        _min = std::min(_min, other._min);
+        _max = std::max(_max, other._max);
+    }
+
+    void toPod(std::vector<uint64_t>& out) const
+    {
+        size_t first = 0;
+        while(first < NUM_BUCKETS && _counts[first] == 0)
+        {
+            ++first;
+        }
+        size_t end = NUM_BUCKETS;
+        while(end > first && _counts[end - 1] == 0)
+        {
+            --end;
+        }
+        out.push_back(_count);
+        out.push_back(_min);
+        out.push_back(_max);
+        out.push_back(first);
+        out.push_back(end - first);
+        out.insert(out.end(), _counts.begin() + first, _counts.begin() + end);
+    }
+
+    /*
+     * Read a histogram written by toPod from [in, end), leaving in just past it. Returns false,
+     * with in untouched, if the words there don't hold one.
+     */
+    bool fromPod(uint64_t const*& in, uint64_t const* end)
+    {
+        if(end - in < (ptrdiff_t) POD_HEADER_WORDS)
+        {
+            return false;
+        }
+        uint64_t const first      = in[3];
+        uint64_t const numBuckets = in[4];
+        if(first > NUM_BUCKETS || numBuckets > NUM_BUCKETS - first ||
+           (uint64_t) (end - in - POD_HEADER_WORDS) < numBuckets)
+        {
+            return false;
+        }
+        _count = in[0];
+        _min   = in[1];
+        _max   = in[2];
+        in += POD_HEADER_WORDS;
+        std::fill(_counts.begin(), _counts.end(), 0);
+        std::copy(in, in + numBuckets, _counts.begin() + first);
+        in += numBuckets;
+        return true;
+    }
+
+    uint64_t count() const
+    {
+        return _count;
+    }
+
+    double minSeconds() const
+    {
+        return _min / 1.0e9;
+    }
+
+    double maxSeconds() const
+    {
+        return _max / 1.0e9;
+    }
+
+    /*
+     * The latency below which the given fraction of the recorded values fall, rounded up to the
+     * top of its bucket and clamped to the exact extremes. Undefined when nothing was recorded.
+     */
+    double quantileSeconds(double fraction) const
+    {
+        uint64_t const rank = std::max<uint64_t>((uint64_t) (fraction * _count + 0.5), 1);
+        uint64_t seen = 0;
+        for(size_t b = 0; b<NUM_BUCKETS; ++b)
+        {
+            seen += _counts[b];
+            if(seen >= rank)
+            {
+                return std::max(std::min(bucketHighestValue(b), _max), _min) / 1.0e9;
+            }
+        }
+        return maxSeconds();
+    }
+};
+
+} } //namespaces
+
+#endif //latency_histogram
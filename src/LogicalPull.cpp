@@ -58,7 +58,7 @@ public:
     {
         std::vector<std::shared_ptr<OperatorParamPlaceholder> > res;
         res.push_back(END_OF_VARIES_PARAMS());
-        if(_parameters.size()<2)
+        if(_parameters.size()<pull::Settings::MAX_PARAMETERS)
         {
             res.push_back(PARAM_CONSTANT("string"));
         }
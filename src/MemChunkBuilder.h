@@ -1,6 +1,7 @@
 #ifndef MEMCHUNK_BUILDER
 #define MEMCHUNK_BUILDER
 
+#include <algorithm>
 #include <limits>
 #include <sstream>
 #include <memory>
@@ -33,6 +34,10 @@ namespace scidb
 
 using namespace scidb;
 
+/*
+ * Builds a one-cell chunk whose RLE payload holds a single variable-size value, appended to piece
+ * by piece with addData. The chunk's buffer grows in place.
+ */
 class MemChunkBuilder
 {
 private:
@@ -57,8 +62,8 @@ public:
 
     static const size_t s_startingSize = 20*1024*1024;
 
-    MemChunkBuilder():
-        _allocSize(s_startingSize)
+    MemChunkBuilder(size_t const startingSize = s_startingSize):
+        _allocSize(std::max(startingSize, chunkDataOffset()))
     {
         _chunk.allocate(_allocSize);
         _chunkStartPointer = (char*) _chunk.getData();
@@ -91,6 +96,10 @@ public:
         return (_writePointer - _chunkStartPointer);
     }
 
+    /*
+     * Growing doubles the buffer with MemChunk::reallocate, which keeps the contents: realloc
+     * moves them at most once, and large buffers are usually remapped without copying at all.
+     */
     inline void addData(char const* data, size_t const size)
     {
         if( getTotalSize() + size > _allocSize)
@@ -100,11 +109,8 @@ public:
             {
                 _allocSize = _allocSize * 2;
             }
-            std::vector<char> buf(_allocSize);
-            memcpy(&(buf[0]), _chunk.getData(), mySize);
-            _chunk.allocate(_allocSize);
+            _chunk.reallocate(_allocSize);
             _chunkStartPointer = (char*) _chunk.getData();
-            memcpy(_chunkStartPointer, &(buf[0]), mySize);
             _dataStartPointer = _chunkStartPointer + chunkDataOffset();
             _sizePointer = (uint32_t*) (_chunkStartPointer + chunkSizeOffset());
             _writePointer = _chunkStartPointer + mySize;
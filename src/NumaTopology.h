@@ -0,0 +1,205 @@
+/*
+**
+* BEGIN_COPYRIGHT
+*
+* Copyright (C) 2008-2016 SciDB, Inc.
+* All Rights Reserved.
+*
+* Pull is a plugin for SciDB, an Open Source Array DBMS maintained
+* by Paradigm4. See http://www.paradigm4.com/
+*
+* Pull is free software: you can redistribute it and/or modify
+* it under the terms of the AFFERO GNU General Public License as published by
+* the Free Software Foundation.
+*
+* summarize is distributed "AS-IS" AND WITHOUT ANY WARRANTY OF ANY KIND,
+* INCLUDING ANY IMPLIED WARRANTY OF MERCHANTABILITY,
+* NON-INFRINGEMENT, OR FITNESS FOR A PARTICULAR PURPOSE. See
+* the AFFERO GNU General Public License for the complete license terms.
+*
+* You should have received a copy of the AFFERO GNU General Public License
+* along with summarize.  If not, see <http://www.gnu.org/licenses/agpl-3.0.html>
+*
+* END_COPYRIGHT
+*/
+
+#ifndef NUMA_TOPOLOGY
+#define NUMA_TOPOLOGY
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sched.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+namespace scidb
+{
+namespace pull
+{
+
+/*
+ * The NUMA nodes of this host and the CPUs on them that the process may run on, from sysfs, so
+ * that no libnuma is needed. A host without NUMA information is one node with every CPU.
+ */
+class NumaTopology
+{
+private:
+    static const size_t MAX_NODES = 64;     //nodes fit a single mbind mask word
+
+    std::vector<std::vector<int> > _nodeCpus;
+    std::vector<int>               _cpuNode;
+
+    static std::vector<int> parseCpuList(std::string const& list)
+    {
+        std::vector<int> cpus;
+        std::istringstream in(list);
+        std::string range;
+        while(std::getline(in, range, ','))
+        {
+            int first = -1;
+            int last = -1;
+            char dash = 0;
+            std::istringstream bounds(range);
+            bounds >> first;
+            if(first < 0)
+            {
+                continue;
+            }
+            last = (bounds >> dash >> last) && dash == '-' ? last : first;
+            for(int c = first; c <= last; ++c)
+            {
+                cpus.push_back(c);
+            }
+        }
+        return cpus;
+    }
+
+    NumaTopology()
+    {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        bool const haveMask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+        for(size_t node = 0; node < MAX_NODES; ++node)
+        {
+            std::ostringstream path;
+            path << "/sys/devices/system/node/node" << node << "/cpulist";
+            std::ifstream file(path.str().c_str());
+            if(!file)
+            {
+                break;
+            }
+            std::string list;
+            std::getline(file, list);
+            std::vector<int> cpus;
+            std::vector<int> const all = parseCpuList(list);
+            for(size_t c = 0; c<all.size(); ++c)
+            {
+                if(!haveMask || CPU_ISSET(all[c], &allowed))
+                {
+                    cpus.push_back(all[c]);
+                }
+            }
+            _nodeCpus.push_back(cpus);
+        }
+        if(_nodeCpus.empty())
+        {
+            std::vector<int> cpus;
+            long const numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+            for(int c = 0; c < numCpus; ++c)
+            {
+                if(!haveMask || CPU_ISSET(c, &allowed))
+                {
+                    cpus.push_back(c);
+                }
+            }
+            _nodeCpus.push_back(cpus);
+        }
+        for(size_t node = 0; node<_nodeCpus.size(); ++node)
+        {
+            for(size_t c = 0; c<_nodeCpus[node].size(); ++c)
+            {
+                int const cpu = _nodeCpus[node][c];
+                if((size_t) cpu >= _cpuNode.size())
+                {
+                    _cpuNode.resize(cpu + 1, 0);
+                }
+                _cpuNode[cpu] = node;
+            }
+        }
+    }
+
+public:
+    static NumaTopology const& instance()
+    {
+        static NumaTopology const topology;
+        return topology;
+    }
+
+    size_t numNodes() const
+    {
+        return _nodeCpus.size();
+    }
+
+    /*
+     * The CPUs of node the process may use; empty for a memory-only node.
+     */
+    std::vector<int> const& cpus(size_t const node) const
+    {
+        return _nodeCpus[node];
+    }
+
+    size_t nodeOf(int const cpu) const
+    {
+        return cpu >= 0 && (size_t) cpu < _cpuNode.size() ? _cpuNode[cpu] : 0;
+    }
+
+    /*
+     * The node the calling thread is running on right now.
+     */
+    size_t currentNode() const
+    {
+        return nodeOf(sched_getcpu());
+    }
+
+    uint64_t allNodesMask() const
+    {
+        return _nodeCpus.size() >= MAX_NODES ? ~((uint64_t) 0) : (((uint64_t) 1) << _nodeCpus.size()) - 1;
+    }
+};
+
+/*
+ * Restrict the calling thread to cpus. Returns false if the kernel refused.
+ */
+inline bool bindThreadToCpus(std::vector<int> const& cpus)
+{
+    if(cpus.empty())
+    {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(size_t c = 0; c<cpus.size(); ++c)
+    {
+        CPU_SET(cpus[c], &set);
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+/*
+ * Apply a memory policy (MPOL_BIND, MPOL_INTERLEAVE, ...) over nodeMask to a mapping that hasn't
+ * been touched yet. Returns false if the kernel refused, in which case the pages go wherever
+ * they are first touched.
+ */
+inline bool placeMemory(void* const data, size_t const size, int const mode, uint64_t const nodeMask)
+{
+    unsigned long mask = nodeMask;
+    return syscall(SYS_mbind, data, size, mode, &mask, sizeof(mask) * 8, 0) == 0;
+}
+
+} } //namespaces
+
+#endif //numa_topology
@@ -0,0 +1,149 @@
+/*
+**
+* BEGIN_COPYRIGHT
+*
+* Copyright (C) 2008-2016 SciDB, Inc.
+* All Rights Reserved.
+*
+* Pull is a plugin for SciDB, an Open Source Array DBMS maintained
+* by Paradigm4. See http://www.paradigm4.com/
+*
+* Pull is free software: you can redistribute it and/or modify
+* it under the terms of the AFFERO GNU General Public License as published by
+* the Free Software Foundation.
+*
+* summarize is distributed "AS-IS" AND WITHOUT ANY WARRANTY OF ANY KIND,
+* INCLUDING ANY IMPLIED WARRANTY OF MERCHANTABILITY,
+* NON-INFRINGEMENT, OR FITNESS FOR A PARTICULAR PURPOSE. See
+* the AFFERO GNU General Public License for the complete license terms.
+*
+* You should have received a copy of the AFFERO GNU General Public License
+* along with summarize.  If not, see <http://www.gnu.org/licenses/agpl-3.0.html>
+*
+* END_COPYRIGHT
+*/
+
+#ifndef PERF_COUNTERS
+#define PERF_COUNTERS
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "PullSettings.h"
+
+namespace scidb
+{
+namespace pull
+{
+
+/*
+ * The PullCounters of the calling thread, through perf_event_open. Cycles lead a group that
+ * instructions and LLC misses join, so the three are scheduled onto the PMU together; the
+ * software counters stand alone. Counting starts as soon as the counters are opened.
+ *
+ * A counter that can't be opened (no PMU in a VM, perf_event_paranoid, seccomp) is left out and
+ * reads as 0; available() tells which. When kernel profiling isn't permitted the counters fall
+ * back to user space only.
+ */
+class PerfCounters
+{
+private:
+    int _fds[NUM_COUNTERS];
+
+    PerfCounters(PerfCounters const&);
+    PerfCounters& operator=(PerfCounters const&);
+
+    static int openCounter(uint32_t const type, uint64_t const config, int const groupFd)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size        = sizeof(attr);
+        attr.type        = type;
+        attr.config      = config;
+        attr.exclude_hv  = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+        if(fd < 0 && errno == EACCES)
+        {
+            attr.exclude_kernel = 1;
+            fd = syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+        }
+        if(fd < 0 && groupFd >= 0)
+        {
+            //some PMUs can't take every event in one group; count it on its own
+            return openCounter(type, config, -1);
+        }
+        return fd;
+    }
+
+public:
+    PerfCounters()
+    {
+        uint64_t const llcReadMiss = PERF_COUNT_HW_CACHE_LL |
+                                     (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        _fds[COUNTER_CYCLES]           = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,       -1);
+        _fds[COUNTER_INSTRUCTIONS]     = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,     _fds[COUNTER_CYCLES]);
+        _fds[COUNTER_LLC_MISSES]       = openCounter(PERF_TYPE_HW_CACHE, llcReadMiss,                    _fds[COUNTER_CYCLES]);
+        _fds[COUNTER_PAGE_FAULTS]      = openCounter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS,      -1);
+        _fds[COUNTER_CONTEXT_SWITCHES] = openCounter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, -1);
+    }
+
+    ~PerfCounters()
+    {
+        for(size_t c = 0; c<NUM_COUNTERS; ++c)
+        {
+            if(_fds[c] >= 0)
+            {
+                close(_fds[c]);
+            }
+        }
+    }
+
+    bool available(size_t const counter) const
+    {
+        return _fds[counter] >= 0;
+    }
+
+    /*
+     * A bit per PullCounter that couldn't be opened.
+     */
+    uint64_t missing() const
+    {
+        uint64_t mask = 0;
+        for(size_t c = 0; c<NUM_COUNTERS; ++c)
+        {
+            if(!available(c))
+            {
+                mask |= 1 << c;
+            }
+        }
+        return mask;
+    }
+
+    /*
+     * Current totals since the counters were opened. A counter the kernel had to multiplex off
+     * the PMU for a while is scaled up by enabled over running time.
+     */
+    void read(uint64_t* values) const
+    {
+        for(size_t c = 0; c<NUM_COUNTERS; ++c)
+        {
+            values[c] = 0;
+            uint64_t raw[3];    //value, time enabled, time running
+            if(_fds[c] < 0 || ::read(_fds[c], raw, sizeof(raw)) != (ssize_t) sizeof(raw) || raw[2] == 0)
+            {
+                continue;
+            }
+            values[c] = raw[2] < raw[1] ? (uint64_t) (raw[0] * ((double) raw[1] / raw[2])) : raw[0];
+        }
+    }
+};
+
+} } //namespaces
+
+#endif //perf_counters
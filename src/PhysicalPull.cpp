@@ -34,6 +34,12 @@
 #include <log4cxx/logger.h>
 #include "PullSettings.h"
 #include "MemChunkBuilder.h"
+#include "PullSinks.h"
+#include "PullTransfer.h"
+#include "PerfCounters.h"
+#include "StorageFiles.h"
+#include "ColumnFile.h"
+#include "NumaTopology.h"
 
 #include <query/TypeSystem.h>
 #include <query/FunctionDescription.h>
@@ -61,6 +67,13 @@
 #include <iomanip>
 #include <chrono>
 #include <ctime>
+#include <atomic>
+#include <exception>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
 
 using std::shared_ptr;
 using std::make_shared;
@@ -83,6 +96,723 @@ static size_t getSizeOffset()
     return getChunkOverheadSize()-4;
 }
 
+typedef std::chrono::high_resolution_clock PullClock;
+
+static double secondsSince(PullClock::time_point const& start)
+{
+    return std::chrono::duration<double>(PullClock::now() - start).count();
+}
+
+/*
+ * Run work(threadIndex) on numThreads threads and wait for all of them. The first exception
+ * thrown by a worker is rethrown here once everyone has joined.
+ */
+static void runWorkers(size_t const numThreads, std::function<void(size_t)> const& work)
+{
+    if(numThreads == 1)
+    {
+        work(0);
+        return;
+    }
+    vector<std::thread> workers;
+    vector<std::exception_ptr> errors(numThreads);
+    for(size_t t = 0; t<numThreads; ++t)
+    {
+        workers.emplace_back([&work, &errors, t]()
+        {
+            try
+            {
+                work(t);
+            }
+            catch (...)
+            {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    for(size_t t = 0; t<numThreads; ++t)
+    {
+        workers[t].join();
+    }
+    for(size_t t = 0; t<numThreads; ++t)
+    {
+        if(errors[t])
+        {
+            std::rethrow_exception(errors[t]);
+        }
+    }
+}
+
+/*
+ * A unit of work for one pull worker: the chunks of one attribute at positions[begin, end), or,
+ * when positions is NULL, every chunk of the attribute in iterator order.
+ */
+struct PullTask
+{
+    AttributeID         att;
+    vector<Coordinates> const* positions;
+    size_t              begin;
+    size_t              end;
+};
+
+/*
+ * Walk one attribute's array iterator and record where its chunks are, without reading them.
+ */
+static vector<Coordinates> collectChunkPositions(shared_ptr<Array> const& inputArray, AttributeID const att)
+{
+    vector<Coordinates> positions;
+    shared_ptr<ConstArrayIterator> iaiter = inputArray->getConstIterator(att);
+    while(!iaiter->end())
+    {
+        positions.push_back(iaiter->getPosition());
+        ++(*iaiter);
+    }
+    return positions;
+}
+
+/*
+ * Rearrange the collected chunk positions into the order= visit order. The random order is seeded
+ * by the instance, so that repeated runs visit the chunks in the same order while instances don't
+ * walk the storage in lock step.
+ */
+static void orderChunkPositions(vector<Coordinates>& positions, pull::Settings const& settings, InstanceID const instanceId)
+{
+    switch(settings.visitOrder())
+    {
+    case pull::ORDER_NATURAL:
+        break;
+    case pull::ORDER_COORDINATE:
+        std::sort(positions.begin(), positions.end());
+        break;
+    case pull::ORDER_RANDOM:
+    {
+        std::mt19937_64 rng(fmix((uint64_t) instanceId + 1));
+        std::shuffle(positions.begin(), positions.end(), rng);
+        break;
+    }
+    case pull::ORDER_STRIDE:
+    {
+        size_t const stride = settings.orderStride();
+        vector<Coordinates> strided;
+        strided.reserve(positions.size());
+        for(size_t offset = 0; offset<stride && offset<positions.size(); ++offset)
+        {
+            for(size_t i = offset; i<positions.size(); i += stride)
+            {
+                strided.push_back(positions[i]);
+            }
+        }
+        positions.swap(strided);
+        break;
+    }
+    }
+}
+
+/*
+ * Split the chunk positions of every attribute read into numRanges disjoint contiguous ranges.
+ * The tasks of one attribute are adjacent, so that idle workers pile onto the same attribute.
+ */
+static vector<PullTask> makeRangeTasks(vector<AttributeID> const& atts, vector<Coordinates> const& positions, size_t const numRanges)
+{
+    vector<PullTask> tasks;
+    size_t const numChunks = positions.size();
+    for(size_t a = 0; a<atts.size(); ++a)
+    {
+        for(size_t r = 0; r<numRanges; ++r)
+        {
+            PullTask task;
+            task.att       = atts[a];
+            task.positions = &positions;
+            task.begin     = r * numChunks / numRanges;
+            task.end       = (r+1) * numChunks / numRanges;
+            if(task.end > task.begin)
+            {
+                tasks.push_back(task);
+            }
+        }
+    }
+    return tasks;
+}
+
+/*
+ * Splits the read of one chunk into consecutive phases: each lap() charges the time since the
+ * previous lap to the given phase. Kept apart from ThreadSummary so that the prefetch producer
+ * can time its phases without touching the consumer's accumulators.
+ */
+struct PhaseTimer
+{
+    PullClock::time_point last;
+    double                seconds[pull::NUM_PHASES];
+
+    PhaseTimer():
+        last(PullClock::now())
+    {
+        std::fill(seconds, seconds + pull::NUM_PHASES, 0.0);
+    }
+
+    void lap(pull::PullPhase const phase)
+    {
+        PullClock::time_point const now = PullClock::now();
+        seconds[phase] += std::chrono::duration<double>(now - last).count();
+        last = now;
+    }
+};
+
+/*
+ * One in-flight chunk of the prefetch pipeline. Every slot has an array iterator of its own,
+ * because a ConstChunk reference is only good until the iterator that produced it moves.
+ */
+struct PrefetchSlot
+{
+    shared_ptr<ConstArrayIterator> iaiter;
+    shared_ptr<ConstChunkIterator> iciter;
+    ConstChunk const*              chunk;
+    bool                           pinned;
+    double                         fetchSeconds;
+    PhaseTimer                     fetchTimer;
+    uint64_t                       fetchCounters[pull::NUM_COUNTERS];  //the producer's, counters=true only
+
+    PrefetchSlot():
+        chunk(NULL),
+        pinned(false),
+        fetchSeconds(0)
+    {}
+
+    void release()
+    {
+        if(chunk != NULL && pinned)
+        {
+            chunk->unPin();
+        }
+        chunk = NULL;
+        pinned = false;
+    }
+};
+
+/*
+ * Where worker t runs and keeps its staging memory under numa= and pin=. Workers are dealt
+ * round-robin over the nodes, or all go to node K, and may run on any core of their node;
+ * pinned, each gets a core of its node to itself, as long as there are enough. An empty cpus
+ * leaves the thread where it is.
+ */
+struct WorkerPlacement
+{
+    vector<int> cpus;
+    int         policy;     //for mbind
+    uint64_t    nodeMask;
+
+    WorkerPlacement(pull::Settings const& settings, size_t const t):
+        policy(MPOL_DEFAULT),
+        nodeMask(0)
+    {
+        if(!settings.numaflag())
+        {
+            return;
+        }
+        pull::NumaTopology const& topology = pull::NumaTopology::instance();
+        bool const fixedNode = settings.numaPolicy() == pull::NUMA_NODE;
+        size_t const node = fixedNode ? settings.numaNode() : t % topology.numNodes();
+        vector<int> const& nodeCpus = topology.cpus(node);
+        if(settings.pinflag() && !nodeCpus.empty())
+        {
+            size_t const slot = fixedNode ? t : t / topology.numNodes();
+            cpus.push_back(nodeCpus[slot % nodeCpus.size()]);
+        }
+        else if(fixedNode || settings.numaPolicy() == pull::NUMA_LOCAL)
+        {
+            cpus = nodeCpus;
+        }
+        switch(settings.numaPolicy())
+        {
+        case pull::NUMA_DEFAULT:
+            break;
+        case pull::NUMA_LOCAL:
+            if(!cpus.empty())
+            {
+                //a node without cores of its own leaves the thread, and first touch, where it is
+                policy   = MPOL_BIND;
+                nodeMask = ((uint64_t) 1) << node;
+            }
+            break;
+        case pull::NUMA_INTERLEAVE:
+            policy   = MPOL_INTERLEAVE;
+            nodeMask = topology.allNodesMask();
+            break;
+        case pull::NUMA_NODE:
+            policy   = MPOL_BIND;
+            nodeMask = ((uint64_t) 1) << node;
+            break;
+        }
+    }
+};
+
+/*
+ * The read loop of one pull worker thread. Everything it touches is its own except the input
+ * array, which every worker reads through iterators of its own.
+ */
+class PullWorker
+{
+private:
+    shared_ptr<Array> const&          _inputArray;
+    pull::Settings const&             _settings;
+    PullClock::time_point const       _pullStart;
+    WorkerPlacement const             _placement;
+    cpu_set_t                         _savedAffinity;   //restored on exit; a single worker runs on the query's thread
+    bool                              _bound;
+    pull::ThreadArena&                _arena;           //the slot's, kept across iterations
+    std::unique_ptr<pull::ChunkSink>  _sink;
+    pull::ThreadSummary&              _threadSummary;
+    vector<Compressor*>               _compressors;     //NULL for the attribute's own compression
+    CompressedBuffer                  _compressed;      //reused for every chunk
+    pull::AlignedBuffer               _compressScratch;
+    std::unique_ptr<pull::PerfCounters> _counters;      //counters=true only
+    uint64_t                          _countersAtChunkStart[pull::NUM_COUNTERS];
+    uint64_t                          _allocationsAtChunkStart;
+    uint64_t                          _allocatedBytesAtChunkStart;
+
+    void startCounters()
+    {
+        _allocationsAtChunkStart    = _arena.allocations();
+        _allocatedBytesAtChunkStart = _arena.allocatedBytes();
+        if(_counters)
+        {
+            _counters->read(_countersAtChunkStart);
+        }
+    }
+
+    /*
+     * Compress the chunk with every compressor asked for, each timed on its own.
+     */
+    void compressChunk(ConstChunk const& chunk, AttributeID const i, std::shared_ptr<ConstRLEEmptyBitmap>& emptyBitmap)
+    {
+        for(size_t c = 0; c<_compressors.size(); ++c)
+        {
+            PullClock::time_point const compressStart = PullClock::now();
+            size_t compressedSize;
+            if(_compressors[c] == NULL)
+            {
+                chunk.compress(_compressed, emptyBitmap);
+                compressedSize = _compressed.getSize();
+            }
+            else
+            {
+                compressedSize = _compressors[c]->compress(_compressScratch.reserve(chunk.getSize()), chunk, chunk.getSize());
+            }
+            _threadSummary.addCompressData(i, c, compressedSize, secondsSince(compressStart));
+        }
+    }
+
+    /*
+     * Compress a pinned chunk if asked to and hand it to the sink. Returns the number of bytes read.
+     */
+    size_t consumeChunk(ConstChunk const& chunk, AttributeID const i, PhaseTimer& timer, pull::ChunkTrace& trace)
+    {
+        std::shared_ptr<ConstRLEEmptyBitmap> emptyBitmap;
+        if (!_compressors.empty() &&
+            _inputArray->getArrayDesc().getEmptyBitmapAttribute() != NULL &&
+            !chunk.getAttributeDesc().isEmptyIndicator()) {
+            emptyBitmap = chunk.getEmptyBitmap();
+        }
+        timer.lap(pull::PHASE_EMPTY_BITMAP);
+        compressChunk(chunk, i, emptyBitmap);
+        timer.lap(pull::PHASE_COMPRESS);
+        _threadSummary.addDigest(i, _sink->consume(chunk));
+        _threadSummary.addSinkStall(i, _sink->takeStallSeconds());
+        timer.lap(pull::PHASE_CONSUME);
+        if(_settings.traceflag())
+        {
+            traceChunk(chunk, trace);
+        }
+        if(_settings.accessflag())
+        {
+            _threadSummary.addCells(i, countCells(chunk));
+        }
+        return chunk.getSize();
+    }
+
+    /*
+     * The number of cells in a pinned chunk, from its payload header, so counting doesn't add a
+     * pass over the data.
+     */
+    static uint64_t countCells(ConstChunk const& chunk)
+    {
+        if(chunk.getAttributeDesc().isEmptyIndicator())
+        {
+            return ConstRLEEmptyBitmap((char const*) chunk.getConstData()).count();
+        }
+        return ConstRLEPayload((char const*) chunk.getConstData()).count();
+    }
+
+    static void traceChunk(ConstChunk const& chunk, pull::ChunkTrace& trace)
+    {
+        trace.position = chunk.getFirstPosition(false);
+        trace.cells    = countCells(chunk);
+    }
+
+    void finishChunk(AttributeID const i, size_t const bytes, double const chunkStart, double const chunkEnd, double const latency, pull::ChunkTrace& trace)
+    {
+        _threadSummary.addChunkData(i, bytes, chunkStart, chunkEnd, latency);
+        _threadSummary.addAllocations(i, _arena.allocations() - _allocationsAtChunkStart, _arena.allocatedBytes() - _allocatedBytesAtChunkStart);
+        if(_settings.numaflag())
+        {
+            _threadSummary.addNodeBytes(i, pull::NumaTopology::instance().currentNode(), bytes);
+        }
+        if(_counters)
+        {
+            uint64_t deltas[pull::NUM_COUNTERS];
+            _counters->read(deltas);
+            for(size_t c = 0; c<pull::NUM_COUNTERS; ++c)
+            {
+                deltas[c] -= _countersAtChunkStart[c];
+            }
+            _threadSummary.addCounters(i, deltas);
+        }
+        if(_settings.traceflag())
+        {
+            trace.att      = i;
+            trace.bytes    = bytes;
+            trace.start    = chunkStart;
+            trace.duration = chunkEnd - chunkStart;
+            _threadSummary.traces.push_back(trace);
+        }
+    }
+
+    /*
+     * Read the chunk under the iterator. Fetching and consuming happen back to back, so the
+     * consumer stalls for the whole fetch. Returns the number of bytes read.
+     */
+    size_t pullChunk(ConstArrayIterator& iaiter, AttributeID const i, double const chunkStart, PhaseTimer& timer, pull::ChunkTrace& trace)
+    {
+        ConstChunk const& inputChunk = iaiter.getChunk();
+        timer.lap(pull::PHASE_GET_CHUNK);
+        shared_ptr<ConstChunkIterator> iciter = inputChunk.getConstIterator(ConstChunkIterator::IGNORE_OVERLAPS | ConstChunkIterator::IGNORE_EMPTY_CELLS);
+        ConstChunk const& chunk = iciter->getChunk();
+        timer.lap(pull::PHASE_CHUNK_ITERATOR);
+        double fetchEnd;
+        double consumeEnd;
+        size_t sourceSize;
+        {
+            PinBuffer pinScope(chunk);
+            timer.lap(pull::PHASE_PIN);
+            fetchEnd   = secondsSince(_pullStart);
+            sourceSize = consumeChunk(chunk, i, timer, trace);
+            consumeEnd = secondsSince(_pullStart);
+        }
+        //the unpin belongs with the pin, not with moving on to the next chunk
+        timer.lap(pull::PHASE_PIN);
+        _threadSummary.addStageData(i, fetchEnd - chunkStart, consumeEnd - fetchEnd, fetchEnd - chunkStart);
+        return sourceSize;
+    }
+
+    /*
+     * Pipelined variant of pullTask. A producer thread fetches and pins up to depth chunks ahead
+     * of this worker, which consumes them in order. The consumer's per-chunk time is its stall
+     * waiting for the producer plus its own consume time.
+     */
+    void pullTaskPrefetch(PullTask const& task, size_t const depth)
+    {
+        size_t const numChunks = task.end - task.begin;
+        vector<PrefetchSlot> slots(depth);
+        for(size_t k = 0; k<depth; ++k)
+        {
+            slots[k].iaiter = _inputArray->getConstIterator(task.att);
+        }
+        std::mutex mutex;
+        std::condition_variable cond;
+        size_t produced = 0;
+        size_t consumed = 0;
+        bool abort = false;
+        std::exception_ptr producerError;
+        uint64_t producerCountersMissing = 0;
+        std::thread producer([&]()
+        {
+            try
+            {
+                //the fetch work happens on this thread, so it gets counters of its own
+                std::unique_ptr<pull::PerfCounters> counters;
+                if(_settings.countersflag())
+                {
+                    counters.reset(new pull::PerfCounters());
+                    producerCountersMissing = counters->missing();
+                }
+                for(size_t n = 0; n<numChunks; ++n)
+                {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        cond.wait(lock, [&]() { return abort || n - consumed < depth; });
+                        if(abort)
+                        {
+                            return;
+                        }
+                    }
+                    PrefetchSlot& slot = slots[n % depth];
+                    if(counters)
+                    {
+                        counters->read(slot.fetchCounters);
+                    }
+                    slot.fetchTimer = PhaseTimer();
+                    if(!slot.iaiter->setPosition((*task.positions)[task.begin + n]))
+                    {
+                        throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "chunk position vanished during pull";
+                    }
+                    slot.fetchTimer.lap(pull::PHASE_POSITION);
+                    ConstChunk const& inputChunk = slot.iaiter->getChunk();
+                    slot.fetchTimer.lap(pull::PHASE_GET_CHUNK);
+                    slot.iciter = inputChunk.getConstIterator(ConstChunkIterator::IGNORE_OVERLAPS | ConstChunkIterator::IGNORE_EMPTY_CELLS);
+                    ConstChunk const& chunk = slot.iciter->getChunk();
+                    slot.fetchTimer.lap(pull::PHASE_CHUNK_ITERATOR);
+                    slot.pinned = chunk.pin();
+                    slot.chunk = &chunk;
+                    slot.fetchTimer.lap(pull::PHASE_PIN);
+                    if(counters)
+                    {
+                        uint64_t now[pull::NUM_COUNTERS];
+                        counters->read(now);
+                        for(size_t c = 0; c<pull::NUM_COUNTERS; ++c)
+                        {
+                            slot.fetchCounters[c] = now[c] - slot.fetchCounters[c];
+                        }
+                    }
+                    slot.fetchSeconds = 0;
+                    for(size_t p = 0; p<pull::NUM_PHASES; ++p)
+                    {
+                        slot.fetchSeconds += slot.fetchTimer.seconds[p];
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        ++produced;
+                    }
+                    cond.notify_all();
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                producerError = std::current_exception();
+                cond.notify_all();
+            }
+        });
+        std::exception_ptr consumerError;
+        try
+        {
+            for(size_t n = 0; n<numChunks; ++n)
+            {
+                startCounters();
+                double const chunkStart = secondsSince(_pullStart);
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cond.wait(lock, [&]() { return producerError || produced > n; });
+                    if(produced <= n)
+                    {
+                        break;
+                    }
+                }
+                double const readyTime = secondsSince(_pullStart);
+                PrefetchSlot& slot = slots[n % depth];
+                PhaseTimer timer;
+                pull::ChunkTrace trace;
+                size_t const sourceSize = consumeChunk(*slot.chunk, task.att, timer, trace);
+                double const fetchSeconds = slot.fetchSeconds;
+                _threadSummary.addPhaseData(task.att, slot.fetchTimer.seconds);
+                if(_counters)
+                {
+                    _threadSummary.addFetchCounters(task.att, slot.fetchCounters);
+                }
+                slot.release();
+                timer.lap(pull::PHASE_PIN);
+                double const chunkEnd = secondsSince(_pullStart);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    ++consumed;
+                }
+                cond.notify_all();
+                //the producer's fetch plus our consume, without the time in between
+                finishChunk(task.att, sourceSize, chunkStart, chunkEnd, fetchSeconds + (chunkEnd - readyTime), trace);
+                _threadSummary.addStageData(task.att, fetchSeconds, chunkEnd - readyTime, readyTime - chunkStart);
+                _threadSummary.addPhaseData(task.att, timer.seconds);
+            }
+        }
+        catch (...)
+        {
+            consumerError = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            abort = true;
+        }
+        cond.notify_all();
+        producer.join();
+        _threadSummary.markFetchCountersMissing(producerCountersMissing);
+        for(size_t k = 0; k<depth; ++k)
+        {
+            slots[k].release();
+        }
+        if(consumerError)
+        {
+            std::rethrow_exception(consumerError);
+        }
+        if(producerError)
+        {
+            std::rethrow_exception(producerError);
+        }
+    }
+
+    /*
+     * Read the chunks of one task with a ConstArrayIterator of its own. Within a range the
+     * iterator is only repositioned when the next chunk isn't the one it naturally advances to.
+     */
+    void pullTask(PullTask const& task)
+    {
+        shared_ptr<ConstArrayIterator> iaiter = _inputArray->getConstIterator(task.att);
+        size_t const numChunks = task.positions == NULL ? std::numeric_limits<size_t>::max() : task.end - task.begin;
+        for(size_t n = 0; n<numChunks; ++n)
+        {
+            startCounters();
+            double const chunkStart = secondsSince(_pullStart);
+            PhaseTimer timer;
+            if(task.positions == NULL)
+            {
+                if(iaiter->end())
+                {
+                    break;
+                }
+            }
+            else
+            {
+                Coordinates const& pos = (*task.positions)[task.begin + n];
+                if(n == 0 || iaiter->end() || iaiter->getPosition() != pos)
+                {
+                    if(!iaiter->setPosition(pos))
+                    {
+                        throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "chunk position vanished during pull";
+                    }
+                }
+            }
+            timer.lap(pull::PHASE_POSITION);
+            pull::ChunkTrace trace;
+            size_t const sourceSize = pullChunk(*iaiter, task.att, chunkStart, timer, trace);
+            ++(*iaiter);
+            timer.lap(pull::PHASE_POSITION);
+            double const chunkEnd = secondsSince(_pullStart);
+            finishChunk(task.att, sourceSize, chunkStart, chunkEnd, chunkEnd - chunkStart, trace);
+            _threadSummary.addPhaseData(task.att, timer.seconds);
+        }
+    }
+
+public:
+    PullWorker(shared_ptr<Array> const& inputArray,
+               pull::Settings const& settings,
+               PullClock::time_point const& pullStart,
+               pull::ThreadSummary& threadSummary,
+               shared_ptr<pull::SinkTarget> const& target,
+               pull::TokenBucket* bucket,
+               pull::ThreadArena& arena,
+               size_t const workerIndex):
+        _inputArray(inputArray),
+        _settings(settings),
+        _pullStart(pullStart),
+        _placement(settings, workerIndex),
+        _bound(false),
+        _arena(arena),
+        _sink(pull::makeSink(settings, target, bucket, threadSummary, _arena)),
+        _threadSummary(threadSummary),
+        _compressScratch(&_arena),
+        _allocationsAtChunkStart(0),
+        _allocatedBytesAtChunkStart(0)
+    {
+        if(!_placement.cpus.empty() && sched_getaffinity(0, sizeof(_savedAffinity), &_savedAffinity) == 0)
+        {
+            _bound = pull::bindThreadToCpus(_placement.cpus);
+            if(!_bound)
+            {
+                LOG4CXX_WARN(logger, "pull: couldn't bind worker " << workerIndex << " to its cores");
+            }
+        }
+        if(settings.countersflag())
+        {
+            _counters.reset(new pull::PerfCounters());
+            _threadSummary.markCountersMissing(_counters->missing());
+        }
+        for(size_t c = 0; c<settings.numCompressors(); ++c)
+        {
+            int const type = settings.compressorType(c);
+            _compressors.push_back(type == pull::Settings::COMPRESS_OWN ? NULL : CompressorFactory::getInstance().getCompressors()[type]);
+        }
+    }
+
+    ~PullWorker()
+    {
+        if(_bound)
+        {
+            sched_setaffinity(0, sizeof(_savedAffinity), &_savedAffinity);
+        }
+    }
+
+    /*
+     * Called once no tasks are left.
+     */
+    void finish()
+    {
+        _sink->finish();
+    }
+
+    void run(PullTask const& task)
+    {
+        if(_settings.prefetchDepth() > 0)
+        {
+            pullTaskPrefetch(task, _settings.prefetchDepth());
+        }
+        else
+        {
+            pullTask(task);
+        }
+    }
+};
+
+/*
+ * Read every task once with numThreads workers and fold what they measured into summary. Worker
+ * t draws its buffers from arenas[t], made on first use with its placement's memory policy and
+ * kept for the next iteration, so the buffers it grew can be reused.
+ */
+static void pullIteration(shared_ptr<Array> const& inputArray,
+                          pull::Settings const& settings,
+                          vector<PullTask> const& tasks,
+                          size_t const numThreads,
+                          shared_ptr<pull::SinkTarget> const& target,
+                          pull::TokenBucket* bucket,
+                          vector<std::unique_ptr<pull::ThreadArena> >& arenas,
+                          pull::InstanceSummary& summary)
+{
+    if(arenas.size() < numThreads)
+    {
+        arenas.resize(numThreads);
+    }
+    size_t const numInputAtts = settings.numInputAttributes();
+    vector<pull::ThreadSummary> threadSummaries(numThreads, pull::ThreadSummary(numInputAtts));
+    std::atomic<size_t> nextTask(0);
+    PullClock::time_point const pullStart = PullClock::now();
+    summary.startNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    runWorkers(numThreads, [&](size_t t)
+    {
+        if(!arenas[t])
+        {
+            WorkerPlacement const placement(settings, t);
+            arenas[t].reset(new pull::ThreadArena(settings.hugePagesflag(), placement.policy, placement.nodeMask));
+        }
+        PullWorker worker(inputArray, settings, pullStart, threadSummaries[t], target, bucket, *arenas[t], t);
+        for(size_t k = nextTask++; k<tasks.size(); k = nextTask++)
+        {
+            worker.run(tasks[k]);
+        }
+        worker.finish();
+    });
+    summary.wallSeconds = secondsSince(pullStart);
+    for(size_t t = 0; t<numThreads; ++t)
+    {
+        summary.addThreadSummary(threadSummaries[t]);
+    }
+}
+
 class PhysicalPull : public PhysicalOperator
 {
 public:
@@ -110,81 +840,165 @@ std::shared_ptr< Array> execute(std::vector< std::shared_ptr< Array> >& inputArr
     shared_ptr<Array>& inputArray = inputArrays[0];
     ArrayDesc const& inputSchema = inputArray->getArrayDesc();
     pull::Settings settings(inputSchema, _parameters, false, query);
+    settings.checkNumaNodes(_schema);
     size_t const numInputAtts= settings.numInputAttributes();
     vector<string> attNames(numInputAtts);
-    vector<shared_ptr<ConstArrayIterator> > iaiters(numInputAtts);
-    vector<shared_ptr<ConstChunkIterator> > iciters(numInputAtts);
     for(size_t i =0; i<numInputAtts; ++i)
     {
         attNames[i] = inputSchema.getAttributes()[i].getName();
-        iaiters[i] = inputArray->getConstIterator(i);
+    }
+    if(settings.transferflag())
+    {
+        pull::InstanceSummary summary(query->getInstanceID(), numInputAtts, attNames);
+        PullClock::time_point const pullStart = PullClock::now();
+        pull::ChunkTransfer transfer(settings, query, pullStart, summary.links);
+        transfer.run(inputArray);
+        summary.wallSeconds = secondsSince(pullStart);
+        summary.makeFinalSummary(settings, _schema, query);
+        return summary.toArray(settings, _schema, query);
+    }
+    vector<AttributeID> const& atts = settings.selectedAttributes();
+    vector<Coordinates> positions;
+    vector<PullTask> tasks;
+    double scanFraction = 1;
+    if(settings.numRanges() > 1 || settings.prefetchDepth() > 0 || settings.selectionflag() || settings.orderflag())
+    {
+        //ranges, prefetch slots, selected chunks and ordered visits are reached with setPosition
+        inputArray = ensureRandomAccess(inputArray, query);
+        positions = collectChunkPositions(inputArray, numInputAtts-1);
+        if(settings.selectionflag())
+        {
+            size_t const numPositions = positions.size();
+            positions.erase(std::remove_if(positions.begin(), positions.end(),
+                                           [&](Coordinates const& pos) { return !settings.chunkSelected(pos); }),
+                            positions.end());
+            if(numPositions > 0)
+            {
+                scanFraction = ((double) positions.size()) / numPositions;
+            }
+        }
+        orderChunkPositions(positions, settings, query->getInstanceID());
+        tasks = makeRangeTasks(atts, positions, settings.numRanges());
+    }
+    else
+    {
+        for(size_t a = 0; a<atts.size(); ++a)
+        {
+            PullTask task;
+            task.att       = atts[a];
+            task.positions = NULL;
+            task.begin     = 0;
+            task.end       = 0;
+            tasks.push_back(task);
+        }
+    }
+    size_t const maxThreads = settings.sweepflag() ? settings.sweepLevels().back() : settings.numThreads();
+    size_t const numThreads = std::max<size_t>(std::min(maxThreads, tasks.size()), 1);
+    size_t const numRuns = settings.numWarmup() + settings.numIterations();
+    if(numThreads > 1 || numRuns > 1 || settings.sweepflag())
+    {
+        //attributes are iterated concurrently, or the input is read more than once; a
+        //single-pass input can't take that
+        inputArray = ensureRandomAccess(inputArray, query);
     }
 
     pull::InstanceSummary summary(query->getInstanceID(), numInputAtts, attNames);
-
-    std::vector<unsigned char> myVector;
-    std::shared_ptr<MessageDesc> chunkMsg;
-    for(AttributeID i=0; i<numInputAtts; ++i)
+    summary.scanFraction = scanFraction;
+    //evicted with cache=cold, so other arrays keep their pages, and read raw with engine=direct
+    vector<string> arrayFiles;
+    if(settings.cacheMode() == pull::CACHE_COLD || settings.directflag())
     {
-        size_t bytesWritten = 0;
-        //std::clock_t c_start = std::clock();
-
-        while(!iaiters[i]->end())
+        arrayFiles = pull::listArrayFiles(inputSchema.getUAId());
+    }
+    if(settings.cacheMode() == pull::CACHE_COLD && arrayFiles.empty())
+    {
+        LOG4CXX_WARN(logger, "pull: no datastore file is named after array " << inputSchema.getUAId() << "; cache=cold evicts nothing");
+    }
+    //one ring or file per instance, so instances sharing a host don't collide
+    ostringstream targetName;
+    targetName << settings.sinkTarget() << "." << query->getInstanceID();
+    shared_ptr<pull::SinkTarget> target;
+    if(settings.sinkType() == pull::SINK_SHM)
+    {
+        target.reset(new pull::ShmRingProducer("/" + targetName.str()));
+        LOG4CXX_INFO(logger, "pull: publishing chunks to shared-memory ring /" << targetName.str());
+    }
+    //worker t's staging memory, across iterations and sweep levels
+    vector<std::unique_ptr<pull::ThreadArena> > arenas;
+    //warmup and measured iterations with runThreads workers, folded into runSummary
+    auto measure = [&](size_t const runThreads, pull::InstanceSummary& runSummary)
+    {
+        for(size_t run = 0; run<numRuns; ++run)
         {
-            auto t_start = std::chrono::high_resolution_clock::now();
-            //ConstChunk const& chunk = iaiters[i]->getChunk();
-            iciters[i] = iaiters[i]->getChunk().getConstIterator(ConstChunkIterator::IGNORE_OVERLAPS | ConstChunkIterator::IGNORE_EMPTY_CELLS);
-            ConstChunk const& chunk = iciters[i]->getChunk();
-            PinBuffer pinScope(chunk);
-
-            std::shared_ptr<CompressedBuffer> buffer = std::make_shared<CompressedBuffer>();
-            std::shared_ptr<ConstRLEEmptyBitmap> emptyBitmap;
-            if (inputArray->getArrayDesc().getEmptyBitmapAttribute() != NULL &&
-                !chunk.getAttributeDesc().isEmptyIndicator()) {
-                emptyBitmap = chunk.getEmptyBitmap();
+            if(settings.cacheMode() == pull::CACHE_COLD)
+            {
+                size_t const evicted = pull::evictFromPageCache(arrayFiles);
+                LOG4CXX_DEBUG(logger, "pull: evicted " << evicted << " of " << arrayFiles.size() << " array files from the page cache");
             }
-            //chunk.compress(*buffer, emptyBitmap);
-            const void* dataptr = chunk.getConstData();
-            uint32_t sourceSize = chunk.getSize();
-            if(sourceSize > myVector.capacity()){
-            myVector.reserve(sourceSize);
+            pull::InstanceSummary iteration(query->getInstanceID(), numInputAtts, attNames);
+            shared_ptr<pull::ColumnFileWriter> file;
+            if(settings.fileflag())
+            {
+                //every iteration writes the file afresh
+                file.reset(new pull::ColumnFileWriter(targetName.str(), inputSchema, settings.fileDirectflag()));
+                target = file;
+            }
+            std::unique_ptr<pull::TokenBucket> bucket;
+            if(settings.consumeRateflag())
+            {
+                bucket.reset(new pull::TokenBucket(settings.consumeRate(), settings.consumeDelay()));
+            }
+            pullIteration(inputArray, settings, tasks, runThreads, target, bucket.get(), arenas, iteration);
+            if(file)
+            {
+                file->finish();
+                iteration.fileBytes        = file->bytesWritten();
+                iteration.fileWriteSeconds = file->writeSeconds();
+                iteration.fileFsyncSeconds = file->fsyncSeconds();
+            }
+            if(bucket)
+            {
+                iteration.consumerBytes          = bucket->bytesConsumed();
+                iteration.consumerSeconds        = bucket->consumerSeconds();
+                iteration.consumerStarvedSeconds = bucket->starvedSeconds();
+            }
+            if(run >= settings.numWarmup())
+            {
+                runSummary.addIteration(iteration);
             }
-            std::copy((unsigned char*)dataptr, (unsigned char*)dataptr + sourceSize, myVector.begin());
-            //emptyBitmap.reset(); // the bitmask must be cleared before the iterator is advanced (bug?)
-            //chunkMsg = std::make_shared<MessageDesc>(mtRemoteChunk, buffer);
-            //uint32_t foo = chunkMsg->getMessageSize();
-
-            //chunkMsg->getBinary()
-            bytesWritten += sourceSize;
-
-
-            /*
-            char *source = ch.getConstData();
-
-            char *dest;
-            std::memcpy(dest, source, sizeof dest);
-            */
-            //summary.addChunkData(i, chunk.getSize(), chunk.count());
-            ++(*iaiters[i]);
-            //LOG4CXX_DEBUG(logger, std::setprecision(2) << "bytes written:" << bytesWritten);
-            //std::clock_t c_end = std::clock();
-            //double elapsed = 1000.0 *(c_end-c_start) / CLOCKS_PER_SEC;
-            auto t_end = std::chrono::high_resolution_clock::now();
-            double highres = std::chrono::duration<double, std::nano>(t_end-t_start).count();
-            //LOG4CXX_DEBUG(logger, std::setprecision(4) << "time foo1:" << elapsed);
-            //LOG4CXX_DEBUG(logger, std::setprecision(4) << "time foo2:" << highres);
-            summary.addChunkData(i, sourceSize, highres/1.0e9 );
         }
-
-
-        /*std::cout << std::fixed << std::setprecision(2) << "CPU time used: "
-                   << 1000.0 * (c_end-c_start) / CLOCKS_PER_SEC << " ms\n"
-                   << "Wall clock time passed: "
-                   << std::chrono::duration<double, std::milli>(t_end-t_start).count()
-                   << " ms\n";
-        */
+    };
+    if(settings.sweepflag())
+    {
+        vector<size_t> const& levels = settings.sweepLevels();
+        for(size_t l = 0; l<levels.size(); ++l)
+        {
+            size_t const levelThreads = std::max<size_t>(std::min(levels[l], tasks.size()), 1);
+            pull::InstanceSummary levelSummary(query->getInstanceID(), numInputAtts, attNames);
+            levelSummary.scanFraction = scanFraction;
+            measure(levelThreads, levelSummary);
+            summary.sweep.push_back(pull::SweepLevel(levels[l], levelThreads, levelSummary.totalOverAttributes()));
+        }
+    }
+    else
+    {
+        measure(numThreads, summary);
+    }
+    if(settings.directflag())
+    {
+        //the same data without SciDB: what the iterator passes leave on the table
+        if(arrayFiles.empty())
+        {
+            //other arrays' files would be no baseline for this one; the direct columns stay null
+            LOG4CXX_WARN(logger, "pull: no datastore file is named after array " << inputSchema.getUAId() << "; skipping engine=direct");
+        }
+        else
+        {
+            pull::DirectReader reader(arrayFiles);
+            summary.directSeconds = reader.run(settings.queueDepth());
+            summary.directBytes   = reader.bytesRead();
+        }
     }
-
 
     summary.makeFinalSummary(settings, _schema, query);
     return summary.toArray(settings, _schema, query);
@@ -30,22 +30,28 @@
 #include <sstream>
 #include <memory>
 #include <string>
+#include <set>
 #include <vector>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
 #include <ctype.h>
+#include <string.h>
 
 #include <query/Operator.h>
 #include <query/AttributeComparator.h>
 #include <util/Platform.h>
 #include <util/Network.h>
+#include <array/Compressor.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/unordered_map.hpp>
 #include <boost/lexical_cast.hpp>
 
-#include <boost/archive/binary_oarchive.hpp>
-#include <boost/archive/binary_iarchive.hpp>
-#include <boost/serialization/list.hpp>
-#include <boost/serialization/vector.hpp>
+#include <MurmurHash/MurmurHash3.h>
+
+#include "LatencyHistogram.h"
+#include "NumaTopology.h"
 
 namespace scidb
 {
@@ -65,6 +71,114 @@ using boost::starts_with;
 using boost::lexical_cast;
 using boost::bad_lexical_cast;
 
+/*
+ * The consecutive steps of reading one chunk, timed separately for breakdown=true.
+ */
+enum PullPhase
+{
+    PHASE_POSITION = 0,     //setPosition or ++ on the array iterator
+    PHASE_GET_CHUNK,        //ConstArrayIterator::getChunk
+    PHASE_CHUNK_ITERATOR,   //ConstChunk::getConstIterator
+    PHASE_PIN,              //pinning the chunk; this is where the disk read happens
+    PHASE_EMPTY_BITMAP,     //fetching the chunk's empty bitmap
+    PHASE_COMPRESS,         //compressing the payload, with compress= only
+    PHASE_CONSUME,          //handing the payload to the sink
+    NUM_PHASES
+};
+
+static char const* const PHASE_NAMES[NUM_PHASES] =
+{
+    "position",
+    "get_chunk",
+    "chunk_iterator",
+    "pin",
+    "empty_bitmap",
+    "compress",
+    "consume"
+};
+
+/*
+ * Hardware and kernel counters sampled around every chunk with counters=true.
+ */
+enum PullCounter
+{
+    COUNTER_CYCLES = 0,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_LLC_MISSES,
+    COUNTER_PAGE_FAULTS,
+    COUNTER_CONTEXT_SWITCHES,
+    NUM_COUNTERS
+};
+
+static char const* const COUNTER_NAMES[NUM_COUNTERS] =
+{
+    "cycles",
+    "instructions",
+    "llc_misses",
+    "page_faults",
+    "context_switches"
+};
+
+/*
+ * How a pinned chunk is read: its raw payload handed to a sink, every cell through
+ * ConstChunkIterator::getItem, or tiles of values through ConstChunkIterator::getData.
+ */
+enum AccessType
+{
+    ACCESS_RAW = 0,
+    ACCESS_CELL,
+    ACCESS_TILE
+};
+
+enum CacheMode
+{
+    CACHE_AS_IS = 0,    //whatever the previous query left behind
+    CACHE_COLD,         //evicted from the OS page cache before every iteration
+    CACHE_WARM          //read at least once before the measured iterations
+};
+
+/*
+ * The order the chunk positions are visited in with order=. Without it the array iterator is
+ * walked as is.
+ */
+enum VisitOrder
+{
+    ORDER_NATURAL = 0,  //the array iterator's order, replayed with setPosition
+    ORDER_COORDINATE,   //row-major by chunk position
+    ORDER_RANDOM,       //shuffled with a fixed seed per instance
+    ORDER_STRIDE        //every K-th position, then every K-th from the next offset, ...
+};
+
+/*
+ * Where workers put their staging memory with numa=.
+ */
+enum NumaPolicy
+{
+    NUMA_DEFAULT = 0,   //first touch
+    NUMA_LOCAL,         //the node the worker is pinned to, or runs on
+    NUMA_INTERLEAVE,    //page by page across every node
+    NUMA_NODE           //node K, with the workers kept on its CPUs
+};
+
+enum Engine
+{
+    ENGINE_ITERATOR = 0,    //ConstArrayIterator only
+    ENGINE_DIRECT           //and then the instance's storage files, raw, with O_DIRECT
+};
+
+/*
+ * What a consumer does with each pinned chunk, see PullSinks.h.
+ */
+enum SinkType
+{
+    SINK_NONE,              //nothing; measures the read alone
+    SINK_MEMCPY,            //copy the payload to an aligned staging buffer
+    SINK_CHECKSUM,          //hash every byte of the payload into a per-attribute digest
+    SINK_DECODE,            //materialize the values densely
+    SINK_SHM,               //hand the payload to another process through a shared-memory ring
+    SINK_FILE               //stream the payload into a column file per instance
+};
+
 /*
  * Settings for the pull operator.
  */
@@ -73,26 +187,152 @@ class Settings
 private:
     size_t _numInputAttributes;
     size_t _numInstances;
+    vector<string> _inputDimensionNames;
+    vector<int64_t> _chunkIntervals;
     bool _perAttributeSet;
     bool _perAttribute;
     bool _perInstanceSet;
     bool _perInstance;
+    bool _threadsSet;
+    size_t _threads;
+    bool _rangesSet;
+    size_t _ranges;
+    bool _prefetchSet;
+    size_t _prefetch;
+    bool _breakdownSet;
+    bool _breakdown;
+    bool _sinkSet;
+    SinkType _sink;
+    string _sinkTarget;
+    bool _fileDirectSet;
+    bool _fileDirect;
+    bool _batchBytesSet;
+    size_t _batchBytes;
+    bool _hugePagesSet;
+    bool _hugePages;
+    bool _numaSet;
+    NumaPolicy _numa;
+    size_t _numaNode;
+    bool _pinSet;
+    bool _pin;
+    size_t _numNumaNodes;
+    bool _consumeRateSet;
+    double _consumeRate;
+    bool _consumeDelaySet;
+    double _consumeDelay;
+    bool _sweepSet;
+    string _sweep;
+    vector<size_t> _sweepLevels;
+    bool _traceSet;
+    bool _trace;
+    bool _transferSet;
+    int64_t _transferTarget;
+    bool _compressSet;
+    string _compress;
+    bool _accessSet;
+    AccessType _access;
+    bool _countersSet;
+    bool _counters;
+    bool _iterationsSet;
+    size_t _iterations;
+    bool _warmupSet;
+    size_t _warmup;
+    bool _cacheSet;
+    CacheMode _cache;
+    bool _attrsSet;
+    string _attrs;
+    vector<AttributeID> _selectedAttributes;
+    bool _boxSet;
+    string _box;
+    Coordinates _boxLow;
+    Coordinates _boxHigh;
+    bool _sampleSet;
+    double _sample;
+    bool _orderSet;
+    VisitOrder _order;
+    size_t _orderStride;
+    bool _engineSet;
+    Engine _engine;
+    bool _queueDepthSet;
+    size_t _queueDepth;
+    vector<int> _compressorTypes;
+    vector<string> _compressorNames;
 
 public:
-    static const size_t MAX_PARAMETERS = 2;
+    static const size_t MAX_PARAMETERS = 29;
     Settings(ArrayDesc const& inputSchema,
              vector< shared_ptr<OperatorParam> > const& operatorParameters,
              bool logical,
              shared_ptr<Query>& query):
         _numInputAttributes(inputSchema.getAttributes().size()),
         _numInstances(query->getInstancesCount()),
+        _inputDimensionNames(inputSchema.getDimensions().size()),
+        _chunkIntervals(inputSchema.getDimensions().size()),
         _perAttributeSet(false),
         _perAttribute(false),
         _perInstanceSet(false),
-        _perInstance(false)
+        _perInstance(false),
+        _threadsSet(false),
+        _threads(1),
+        _rangesSet(false),
+        _ranges(1),
+        _prefetchSet(false),
+        _prefetch(0),
+        _breakdownSet(false),
+        _breakdown(false),
+        _sinkSet(false),
+        _sink(SINK_MEMCPY),
+        _fileDirectSet(false),
+        _fileDirect(false),
+        _batchBytesSet(false),
+        _batchBytes(0),
+        _hugePagesSet(false),
+        _hugePages(false),
+        _numaSet(false),
+        _numa(NUMA_DEFAULT),
+        _numaNode(0),
+        _pinSet(false),
+        _pin(false),
+        _numNumaNodes(0),
+        _consumeRateSet(false),
+        _consumeRate(0),
+        _consumeDelaySet(false),
+        _consumeDelay(0),
+        _sweepSet(false),
+        _traceSet(false),
+        _trace(false),
+        _transferSet(false),
+        _transferTarget(TRANSFER_RING),
+        _compressSet(false),
+        _accessSet(false),
+        _access(ACCESS_RAW),
+        _countersSet(false),
+        _counters(false),
+        _iterationsSet(false),
+        _iterations(1),
+        _warmupSet(false),
+        _warmup(0),
+        _cacheSet(false),
+        _cache(CACHE_AS_IS),
+        _attrsSet(false),
+        _boxSet(false),
+        _sampleSet(false),
+        _sample(1),
+        _orderSet(false),
+        _order(ORDER_NATURAL),
+        _orderStride(1),
+        _engineSet(false),
+        _engine(ENGINE_ITERATOR),
+        _queueDepthSet(false),
+        _queueDepth(4)
     {
         string const perAttributeParamHeader              = "per_attribute=";
         string const perInstanceParamHeader               = "per_instance=";
+        for(size_t i = 0; i<_inputDimensionNames.size(); ++i)
+        {
+            _inputDimensionNames[i] = inputSchema.getDimensions()[i].getBaseName();
+            _chunkIntervals[i]      = inputSchema.getDimensions()[i].getChunkInterval();
+        }
         size_t const nParams = operatorParameters.size();
          if (nParams > MAX_PARAMETERS)
          {   //assert-like exception. Caller should have taken care of this!
@@ -115,6 +355,135 @@ public:
                 parseStringParam(parameterString);
             }
     	}
+        if(_threads == 0)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "threads must be positive";
+        }
+        if(_ranges == 0)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "ranges must be positive";
+        }
+        if(_iterations == 0)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "iterations must be positive";
+        }
+        if(_cache == CACHE_WARM && !_warmupSet)
+        {
+            _warmup = 1;
+        }
+        if(_transferSet && (_iterationsSet || _warmupSet || _cacheSet))
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "transfer runs once; iterations, warmup and cache don't apply";
+        }
+        resolveAttributes(inputSchema);
+        if(_boxSet)
+        {
+            resolveBox();
+        }
+        if(_sampleSet && (_sample <= 0 || _sample > 1))
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "sample must be in (0, 1]";
+        }
+        if(_transferSet && (_attrsSet || selectionflag()))
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "transfer ships every chunk; attrs, box and sample don't apply";
+        }
+        if(_fileDirectSet && _sink != SINK_FILE)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "file_direct only applies to sink=file";
+        }
+        if(_batchBytesSet)
+        {
+            if(_batchBytes == 0 || _batchBytes > MAX_BATCH_BYTES)
+            {
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "batch_bytes must be positive and at most 1GB";
+            }
+            if(_access != ACCESS_RAW || (_sinkSet && _sink != SINK_MEMCPY))
+            {
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "batch_bytes copies raw payloads in place of the memcpy sink";
+            }
+        }
+        if(numaflag())
+        {
+            //the per-node columns assume every host has as many nodes as this one; see checkNumaNodes
+            _numNumaNodes = NumaTopology::instance().numNodes();
+            if(_numa == NUMA_NODE && _numaNode >= _numNumaNodes)
+            {
+                ostringstream error;
+                error<<"numa node "<<_numaNode<<" doesn't exist; this host has "<<_numNumaNodes;
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+            }
+        }
+        if(_consumeRateSet && _consumeRate <= 0)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "consume_rate must be positive";
+        }
+        if(_consumeDelaySet)
+        {
+            if(!_consumeRateSet)
+            {
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "consume_delay only applies with consume_rate";
+            }
+            if(_consumeDelay < 0)
+            {
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "consume_delay can't be negative";
+            }
+        }
+        if(_consumeRateSet && _transferSet)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "transfer doesn't go through a consumer; consume_rate doesn't apply";
+        }
+        if(_sweepSet)
+        {
+            resolveSweep();
+        }
+        if(_queueDepth == 0)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "queue_depth must be positive";
+        }
+        if(_engine == ENGINE_DIRECT && (_attrsSet || selectionflag()))
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "engine=direct reads the whole array; attrs, box and sample don't apply";
+        }
+        if(_queueDepthSet && _engine != ENGINE_DIRECT)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "queue_depth only applies to engine=direct";
+        }
+        if((_transferSet || _trace || _sweepSet) && _engine == ENGINE_DIRECT)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "engine=direct reports next to the summary; trace, transfer and sweep don't have one";
+        }
+        if(_transferSet && _orderSet)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "transfer ships chunks in iterator order; order doesn't apply";
+        }
+        if(_transferSet)
+        {
+            if(_numInstances < 2)
+            {
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "transfer needs at least two instances";
+            }
+            if(_transferTarget != TRANSFER_RING && (size_t) _transferTarget >= _numInstances)
+            {
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "transfer target is not a valid instance";
+            }
+            if(_trace)
+            {
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "trace and transfer can't be combined";
+            }
+            if(_sinkSet || _compressSet || _accessSet || _countersSet || _breakdownSet || _batchBytesSet || _hugePagesSet || numaflag())
+            {
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "transfer ships raw chunks; sink, compress, access, counters, breakdown, batch_bytes, huge_pages, numa and pin don't apply";
+            }
+        }
+        if(_compressSet)
+        {
+            resolveCompressors();
+        }
+        if(_access != ACCESS_RAW && _sinkSet)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "sink only applies to access=raw";
+        }
     }
 private:
 
@@ -146,284 +515,2391 @@ private:
         }
         return false;
     }
-    void parseStringParam(string const& param)
-    {
-        if(checkBoolParam (param,   "per_attribute",       _perAttribute,        _perAttributeSet       ) ) { return; }
-        if(checkBoolParam (param,   "per_instance",       _perInstance,          _perInstanceSet       ) ) { return; }
-        ostringstream error;
-        error<<"unrecognized parameter "<<param;
-        throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
-    }
-public:
-    ArrayDesc getSchema(shared_ptr<Query>& query)
-    {
-        vector<DimensionDesc> dimensions(2);
-        dimensions[0] = DimensionDesc("inst",  0, 0, _numInstances-1,       _numInstances-1,       1,                   0);
-        dimensions[1] = DimensionDesc("attid", 0, 0, _numInputAttributes-1, _numInputAttributes-1, _numInputAttributes, 0);
-        vector<AttributeDesc> attributes;
-        attributes.push_back(AttributeDesc((AttributeID) 0, "att",    TID_STRING, AttributeDesc::IS_NULLABLE, 0));
-        attributes.push_back(AttributeDesc((AttributeID) 1, "read_bytes", TID_UINT64, AttributeDesc::IS_NULLABLE, 0));
-        attributes.push_back(AttributeDesc((AttributeID) 2, "total_seconds", TID_DOUBLE, AttributeDesc::IS_NULLABLE, 0));
-        attributes.push_back(AttributeDesc((AttributeID) 3, "bytes_per_second",  TID_DOUBLE, AttributeDesc::IS_NULLABLE, 0));
-        attributes = addEmptyTagAttribute(attributes);
-        return ArrayDesc("pull", attributes, dimensions, defaultPartitioning(), query->getDefaultArrayResidency());
-    }
-
-    static const size_t NUM_OUTPUT_ATTRIBUTES = 4;
-
-    size_t numInputAttributes() const
-    {
-        return _numInputAttributes;
-    }
-    bool perAttributeflag() const
-    {
-        return _perAttribute;
-    }
-    bool perInstanceflag() const
-    {
-        return _perInstance;
-    }
-
-};
-
-struct SummaryTuple
-{
-private:
-  friend class boost::serialization::access;
-  template<class Archive>
-  void serialize(Archive & ar, const unsigned int /*version*/)
-  {
-	   ar & attName;
-	   ar & readBytes;
-	   ar & totalSeconds;
-	   ar & bytesPerSecond;
-  }
-public:
-	string attName;
-    ssize_t readBytes;
-    double totalSeconds;
-    double bytesPerSecond;
 
-    SummaryTuple(string att = ""):
-        attName(att),
-        readBytes(0),
-        totalSeconds(0),
-        bytesPerSecond(0)
-    {}
-};
-
-struct InstanceSummary
-{
-    InstanceID myInstanceId;
-    vector<SummaryTuple> summaryData;
-    InstanceSummary(InstanceID iid,
-                    size_t const numAttributes,
-                    vector<string> attNames):
-        myInstanceId(iid),
-        summaryData(numAttributes,SummaryTuple())
+    bool checkSizeTParam(string const& param, string const& header, size_t& target, bool& setFlag)
     {
-        for(size_t i =0; i<numAttributes; ++i)
+        string headerWithEq = header + "=";
+        if(starts_with(param, headerWithEq))
         {
-            summaryData[i].attName=attNames[i];
+            if(setFlag)
+            {
+                ostringstream error;
+                error<<"illegal attempt to set "<<header<<" multiple times";
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+            }
+            string paramContent = param.substr(headerWithEq.size());
+            trim(paramContent);
+            try
+            {
+                int64_t val = lexical_cast<int64_t>(paramContent);
+                if(val < 0)
+                {
+                    ostringstream error;
+                    error<<header<<" must be non-negative";
+                    throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+                }
+                target = val;
+                setFlag = true;
+                return true;
+            }
+            catch (bad_lexical_cast const& exn)
+            {
+                ostringstream error;
+                error<<"could not parse "<<param.c_str();
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+            }
         }
+        return false;
     }
 
-    void addChunkData(AttributeID attId, ssize_t attBytes, double attSeconds)
+    bool checkStringParam(string const& param, string const& header, string& target, bool& setFlag)
     {
-        SummaryTuple& tuple = summaryData[attId];
-        tuple.readBytes+=attBytes;
-        tuple.totalSeconds+=attSeconds;
+        string headerWithEq = header + "=";
+        if(starts_with(param, headerWithEq))
+        {
+            if(setFlag)
+            {
+                ostringstream error;
+                error<<"illegal attempt to set "<<header<<" multiple times";
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+            }
+            target = param.substr(headerWithEq.size());
+            trim(target);
+            setFlag = true;
+            return true;
+        }
+        return false;
     }
 
-    bool makeFinalSummary(Settings const&settings, ArrayDesc const& schema, shared_ptr<Query>& query)
+    bool checkSinkParam(string const& param)
     {
-        size_t numAtt = Settings::NUM_OUTPUT_ATTRIBUTES;
-        InstanceID const myId     = query->getInstanceID();
-        InstanceID const coordId  = query->getCoordinatorID() == INVALID_INSTANCE ? myId : query->getCoordinatorID();
-        size_t const numInstances = query->getInstancesCount();
-        bool const perAtt = settings.perAttributeflag();
-        bool const perIns = settings.perInstanceflag();
-        if(perAtt==false && perIns==false)
+        string sink;
+        if(!checkStringParam(param, "sink", sink, _sinkSet))
         {
-            if(myId != coordId)
-            {
-                std::stringstream out;
-                boost::archive::binary_oarchive oa(out);
-                oa << summaryData;
-                out.seekg(0, std::ios::end);
-                size_t bufSize = out.tellg();
-                out.seekg(0,std::ios::beg);
-                auto tmp = out.str();
-                const char* cstr = tmp.c_str();
-                shared_ptr<SharedBuffer> bufsend(new MemoryBuffer(cstr, bufSize));
-                BufSend(coordId, bufsend, query);
-                summaryData.clear();
-            }
-            else
-            {
-                SummaryTuple globalSummary("all");
-                for(size_t att =0; att<summaryData.size(); ++att)
-                {
-                    SummaryTuple& t = summaryData[att];
-                    /*if(att==0)
-                    {
-                        globalSummary.totalCount += t.totalCount;
-                    }
-                    */
-                    globalSummary.totalSeconds += t.totalSeconds;
-                    globalSummary.readBytes += t.readBytes;
-                }
-                for(InstanceID i = 0; i<numInstances; ++i)
-                {
-                    if (i == myId)
-                    {
-                        continue;
-                    }
-                    shared_ptr<SharedBuffer> buf = BufReceive(i, query);
-                    std::string bufstring((const char *)buf->getConstData(), buf->getSize());
-                    std::stringstream ssout;
-                    ssout << bufstring;
-                    boost::archive::binary_iarchive ia(ssout);
-                    std::vector<SummaryTuple> newlist;
-                    ia >> newlist;
-                    std::vector<SummaryTuple>::size_type sz = newlist.size();
-                    for (unsigned att=0; att<sz; att++)
-                    {
-                        SummaryTuple& t = newlist[att];
-                        /*if(att==0)
-                        {
-                            globalSummary.totalCount += t.totalCount;
-                        }
-                        */
-                        globalSummary.totalSeconds += t.totalSeconds;
-                        globalSummary.readBytes += t.readBytes;
-                    }
-                }
-                summaryData.clear();
-                summaryData.push_back(globalSummary);
-            }
+            return false;
         }
-        else if(perAtt && !perIns)
+        if     (sink == "none")     { _sink = SINK_NONE;     }
+        else if(sink == "memcpy")   { _sink = SINK_MEMCPY;   }
+        else if(sink == "checksum") { _sink = SINK_CHECKSUM; }
+        else if(sink == "decode")   { _sink = SINK_DECODE;   }
+        else if(starts_with(sink, "shm:"))
         {
-            if(myId != coordId)
+            _sink = SINK_SHM;
+            _sinkTarget = sink.substr(4);
+            if(_sinkTarget.empty() || _sinkTarget.find('/') != string::npos)
             {
-                std::stringstream out;
-                boost::archive::binary_oarchive oa(out);
-                oa << summaryData;
-                out.seekg(0, std::ios::end);
-                size_t bufSize = out.tellg();
-                out.seekg(0,std::ios::beg);
-                auto tmp = out.str();
-                const char* cstr = tmp.c_str();
-                shared_ptr<SharedBuffer> bufsend(new MemoryBuffer(cstr, bufSize));
-                BufSend(coordId, bufsend, query);
-                summaryData.clear();
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "shm sink needs a name without slashes";
             }
-            else
+        }
+        else if(starts_with(sink, "file:"))
+        {
+            _sink = SINK_FILE;
+            _sinkTarget = sink.substr(5);
+            if(_sinkTarget.empty())
             {
-                for(InstanceID i = 0; i<numInstances; ++i)
-                {
-                    if (i == myId)
-                    {
-                        continue;
-                    }
-                    shared_ptr<SharedBuffer> buf = BufReceive(i, query);
-                    std::string bufstring((const char *)buf->getConstData(), buf->getSize());
-                    std::stringstream ssout;
-                    ssout << bufstring;
-                    boost::archive::binary_iarchive ia(ssout);
-                    std::vector<SummaryTuple> newlist;
-                    ia >> newlist;
-                    std::vector<SummaryTuple>::size_type sz = newlist.size();
-                    //TODO:assert that the coord vector and slave vectors are equal in size or error out.
-                    SummaryTuple summary;
-                    for (unsigned att=0; att<sz; att++)
-                    {
-                        summaryData[att].attName = newlist[att].attName;
-                        summaryData[att].totalSeconds += newlist[att].totalSeconds;
-                        summaryData[att].readBytes += newlist[att].readBytes;
-                        //LOG4CXX_DEBUG(logger, std::setprecision(4) << "readbytes foo3:" << summaryData[att].readBytes);
-                    }
-                }
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "file sink needs a path";
             }
-        }else if (perIns && !perAtt) {
-            std::vector<SummaryTuple>::size_type sz = summaryData.size();
-            SummaryTuple instanceSummary("all");
-            for (unsigned att = 0; att < sz; att++) {
-                /*if(att == 0)
-                 {
-                 instanceSummary.totalCount = summaryData[att].totalCount;
-                 if(instanceSummary.maxChunkCount < summaryData[att].maxChunkCount)
-                 {
-                 instanceSummary.maxChunkCount = summaryData[att].maxChunkCount;
-                 }
-                 if(instanceSummary.minChunkCount > summaryData[att].minChunkCount)
-                 {
-                 instanceSummary.minChunkCount = summaryData[att].minChunkCount;
-                 }
-                 }
-                 */
-                //instanceSummary.numChunks += summaryData[att].numChunks;
-                //instanceSummary.totalBytes += summaryData[att].totalBytes;
-                //instanceSummary[att].attName       = summaryData[att].attName;
-                instanceSummary.totalSeconds += summaryData[att].totalSeconds;
-                instanceSummary.readBytes += summaryData[att].readBytes;
-            }
-            summaryData.clear();
-            summaryData.push_back(instanceSummary);
+        }
+        else
+        {
+            ostringstream error;
+            error<<"unknown sink "<<sink<<"; expected none, memcpy, checksum, decode, shm:<name> or file:<path>";
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
         }
         return true;
     }
 
-    shared_ptr<Array> toArray(Settings const& settings,ArrayDesc const& schema, shared_ptr<Query>& query)
+    bool checkTransferParam(string const& param)
     {
-        shared_ptr<Array> outputArray(new MemArray(schema, query));
-        if (summaryData.size() == 0)
+        string transfer;
+        if(!checkStringParam(param, "transfer", transfer, _transferSet))
         {
-            return outputArray;
+            return false;
         }
-        InstanceID const myId    = query->getInstanceID();
-        InstanceID const coordId = 0;
-        Coordinates position(2,0);
-        size_t numInstances    = query->getInstancesCount();
-        position[0]=myInstanceId;
-        vector<shared_ptr<ArrayIterator> > oaiters(Settings::NUM_OUTPUT_ATTRIBUTES);
-        vector<shared_ptr<ChunkIterator> > ociters(Settings::NUM_OUTPUT_ATTRIBUTES);
-        for(size_t oatt = 0; oatt<Settings::NUM_OUTPUT_ATTRIBUTES; ++oatt)
+        if(transfer == "ring")
         {
-            oaiters[oatt] = outputArray->getIterator(oatt);
-            ociters[oatt] = oaiters[oatt]->newChunk(position).getIterator(query, oatt == 0 ?
-                    ChunkIterator::SEQUENTIAL_WRITE :
-                    ChunkIterator::NO_EMPTY_CHECK | ChunkIterator::SEQUENTIAL_WRITE);
+            _transferTarget = TRANSFER_RING;
+            return true;
         }
-
-        Value buf;
-        for(size_t i=0; i<summaryData.size(); ++i)
+        int64_t target = -1;
+        try
         {
-            SummaryTuple const& t = summaryData[i];
-            LOG4CXX_DEBUG(logger, std::setprecision(4) << "write array read bytes foo4:" << t.readBytes);
-            LOG4CXX_DEBUG(logger, std::setprecision(4) << "write array seconds foo4:"    << t.totalSeconds);
+            target = lexical_cast<int64_t>(transfer);
+        }
+        catch (bad_lexical_cast const& exn)
+        {}
+        if(target < 0)
+        {
+            ostringstream error;
+            error<<"could not parse "<<param.c_str()<<"; expected ring or an instance number";
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+        }
+        _transferTarget = target;
+        return true;
+    }
+
+    bool checkDoubleParam(string const& param, string const& header, double& target, bool& setFlag)
+    {
+        string headerWithEq = header + "=";
+        if(starts_with(param, headerWithEq))
+        {
+            if(setFlag)
+            {
+                ostringstream error;
+                error<<"illegal attempt to set "<<header<<" multiple times";
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+            }
+            string paramContent = param.substr(headerWithEq.size());
+            trim(paramContent);
+            try
+            {
+                target = lexical_cast<double>(paramContent);
+                setFlag = true;
+                return true;
+            }
+            catch (bad_lexical_cast const& exn)
+            {
+                ostringstream error;
+                error<<"could not parse "<<param.c_str();
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+            }
+        }
+        return false;
+    }
+
+    static vector<string> splitList(string const& list)
+    {
+        vector<string> items;
+        boost::algorithm::split(items, list, boost::algorithm::is_any_of(","));
+        for(size_t i = 0; i<items.size(); ++i)
+        {
+            trim(items[i]);
+        }
+        return items;
+    }
+
+    /*
+     * attrs=a,b reads only the named attributes; the empty tag goes by its schema name. Without
+     * attrs every attribute is read.
+     */
+    void resolveAttributes(ArrayDesc const& inputSchema)
+    {
+        Attributes const& attributes = inputSchema.getAttributes();
+        if(!_attrsSet)
+        {
+            for(AttributeID i = 0; i<_numInputAttributes; ++i)
+            {
+                _selectedAttributes.push_back(i);
+            }
+            return;
+        }
+        vector<string> const names = splitList(_attrs);
+        for(size_t n = 0; n<names.size(); ++n)
+        {
+            AttributeID i = 0;
+            while(i<_numInputAttributes && attributes[i].getName() != names[n])
+            {
+                ++i;
+            }
+            if(i == _numInputAttributes)
+            {
+                ostringstream error;
+                error<<"unknown attribute "<<names[n];
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+            }
+            if(!attributeSelected(i))
+            {
+                _selectedAttributes.push_back(i);
+            }
+        }
+        std::sort(_selectedAttributes.begin(), _selectedAttributes.end());
+    }
+
+    /*
+     * sweep=1,2,4,... runs the whole measurement once per thread count, so it replaces threads
+     * and returns its own array.
+     */
+    void resolveSweep()
+    {
+        vector<string> const levels = splitList(_sweep);
+        try
+        {
+            for(size_t n = 0; n<levels.size(); ++n)
+            {
+                int64_t const level = lexical_cast<int64_t>(levels[n]);
+                if(level <= 0 || (n > 0 && (size_t) level <= _sweepLevels.back()))
+                {
+                    throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "sweep needs increasing positive thread counts";
+                }
+                _sweepLevels.push_back(level);
+            }
+        }
+        catch (bad_lexical_cast const& exn)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "could not parse sweep";
+        }
+        if(_threadsSet)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "sweep sets the thread count; threads doesn't apply";
+        }
+        if(_trace || _transferSet)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "sweep can't be combined with trace or transfer";
+        }
+        if(_perAttribute || _perInstance)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "sweep returns a cell per thread count and instance; per_attribute and per_instance don't apply";
+        }
+    }
+
+    /*
+     * box=low1,low2,...,high1,high2,... as in between().
+     */
+    void resolveBox()
+    {
+        vector<string> const bounds = splitList(_box);
+        size_t const numDims = _inputDimensionNames.size();
+        if(bounds.size() != 2 * numDims)
+        {
+            ostringstream error;
+            error<<"box needs "<<2 * numDims<<" coordinates: the low corner, then the high corner";
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+        }
+        try
+        {
+            for(size_t d = 0; d<numDims; ++d)
+            {
+                _boxLow.push_back(lexical_cast<Coordinate>(bounds[d]));
+                _boxHigh.push_back(lexical_cast<Coordinate>(bounds[numDims + d]));
+            }
+        }
+        catch (bad_lexical_cast const& exn)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "could not parse box";
+        }
+    }
+
+    bool checkCacheParam(string const& param)
+    {
+        string cache;
+        if(!checkStringParam(param, "cache", cache, _cacheSet))
+        {
+            return false;
+        }
+        if     (cache == "cold") { _cache = CACHE_COLD; }
+        else if(cache == "warm") { _cache = CACHE_WARM; }
+        else
+        {
+            ostringstream error;
+            error<<"unknown cache "<<cache<<"; expected cold or warm";
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+        }
+        return true;
+    }
+
+    bool checkNumaParam(string const& param)
+    {
+        string numa;
+        if(!checkStringParam(param, "numa", numa, _numaSet))
+        {
+            return false;
+        }
+        string const nodeHeader = "node:";
+        if     (numa == "local")      { _numa = NUMA_LOCAL;      }
+        else if(numa == "interleave") { _numa = NUMA_INTERLEAVE; }
+        else if(starts_with(numa, nodeHeader))
+        {
+            _numa = NUMA_NODE;
+            try
+            {
+                _numaNode = lexical_cast<size_t>(numa.substr(nodeHeader.size()));
+            }
+            catch (bad_lexical_cast const& exn)
+            {
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "could not parse numa node";
+            }
+        }
+        else
+        {
+            ostringstream error;
+            error<<"unknown numa "<<numa<<"; expected local, interleave or node:K";
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+        }
+        return true;
+    }
+
+    bool checkEngineParam(string const& param)
+    {
+        string engine;
+        if(!checkStringParam(param, "engine", engine, _engineSet))
+        {
+            return false;
+        }
+        if     (engine == "iterator") { _engine = ENGINE_ITERATOR; }
+        else if(engine == "direct")   { _engine = ENGINE_DIRECT;   }
+        else
+        {
+            ostringstream error;
+            error<<"unknown engine "<<engine<<"; expected iterator or direct";
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+        }
+        return true;
+    }
+
+    bool checkOrderParam(string const& param)
+    {
+        string order;
+        if(!checkStringParam(param, "order", order, _orderSet))
+        {
+            return false;
+        }
+        string const strideHeader = "stride:";
+        if     (order == "natural")    { _order = ORDER_NATURAL;    }
+        else if(order == "coordinate") { _order = ORDER_COORDINATE; }
+        else if(order == "random")     { _order = ORDER_RANDOM;     }
+        else if(starts_with(order, strideHeader))
+        {
+            _order = ORDER_STRIDE;
+            try
+            {
+                int64_t const stride = lexical_cast<int64_t>(order.substr(strideHeader.size()));
+                if(stride <= 0)
+                {
+                    throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "order stride must be positive";
+                }
+                _orderStride = stride;
+            }
+            catch (bad_lexical_cast const& exn)
+            {
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "could not parse order stride";
+            }
+        }
+        else
+        {
+            ostringstream error;
+            error<<"unknown order "<<order<<"; expected natural, coordinate, random or stride:K";
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+        }
+        return true;
+    }
+
+    bool checkAccessParam(string const& param)
+    {
+        string access;
+        if(!checkStringParam(param, "access", access, _accessSet))
+        {
+            return false;
+        }
+        if     (access == "raw")  { _access = ACCESS_RAW;  }
+        else if(access == "cell") { _access = ACCESS_CELL; }
+        else if(access == "tile") { _access = ACCESS_TILE; }
+        else
+        {
+            ostringstream error;
+            error<<"unknown access "<<access<<"; expected raw, cell or tile";
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+        }
+        return true;
+    }
+
+    /*
+     * compress=true compresses each chunk the way its attribute is configured to be stored.
+     * compress=all sweeps every compressor SciDB has; compress=zlib,bzlib sweeps the ones named.
+     * Names are matched in lower case with spaces as underscores, so "no compression" is
+     * no_compression.
+     */
+    void resolveCompressors()
+    {
+        string const compress = boost::algorithm::to_lower_copy(_compress);
+        if(compress == "false")
+        {
+            return;
+        }
+        if(compress == "true")
+        {
+            _compressorTypes.push_back(COMPRESS_OWN);
+            _compressorNames.push_back("");
+            return;
+        }
+        vector<string> wanted;
+        if(compress != "all")
+        {
+            boost::algorithm::split(wanted, compress, boost::algorithm::is_any_of(","));
+            for(size_t w = 0; w<wanted.size(); ++w)
+            {
+                trim(wanted[w]);
+            }
+        }
+        vector<Compressor*> const& compressors = CompressorFactory::getInstance().getCompressors();
+        for(size_t c = 0; c<compressors.size(); ++c)
+        {
+            if(compressors[c] == NULL)
+            {
+                continue;
+            }
+            string name = boost::algorithm::to_lower_copy(string(compressors[c]->getName()));
+            for(size_t i = 0; i<name.size(); ++i)
+            {
+                if(!isalnum(name[i]))
+                {
+                    name[i] = '_';
+                }
+            }
+            vector<string>::iterator match = std::find(wanted.begin(), wanted.end(), name);
+            if(compress == "all" || match != wanted.end())
+            {
+                _compressorTypes.push_back(compressors[c]->getType());
+                _compressorNames.push_back(name + "_");
+                if(match != wanted.end())
+                {
+                    wanted.erase(match);
+                }
+            }
+        }
+        if(wanted.size() > 0)
+        {
+            ostringstream error;
+            error<<"unknown compressor "<<wanted[0];
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+        }
+    }
+
+    void parseStringParam(string const& param)
+    {
+        if(checkBoolParam (param,   "per_attribute",       _perAttribute,        _perAttributeSet       ) ) { return; }
+        if(checkBoolParam (param,   "per_instance",       _perInstance,          _perInstanceSet       ) ) { return; }
+        if(checkSizeTParam(param,   "threads",             _threads,             _threadsSet            ) ) { return; }
+        if(checkSizeTParam(param,   "ranges",              _ranges,              _rangesSet             ) ) { return; }
+        if(checkSizeTParam(param,   "prefetch",            _prefetch,            _prefetchSet           ) ) { return; }
+        if(checkBoolParam (param,   "breakdown",           _breakdown,           _breakdownSet          ) ) { return; }
+        if(checkSinkParam (param) ) { return; }
+        if(checkBoolParam (param,   "trace",               _trace,               _traceSet              ) ) { return; }
+        if(checkTransferParam(param) ) { return; }
+        if(checkStringParam(param,  "compress",            _compress,            _compressSet           ) ) { return; }
+        if(checkAccessParam(param) ) { return; }
+        if(checkBoolParam (param,   "counters",            _counters,            _countersSet           ) ) { return; }
+        if(checkSizeTParam(param,   "iterations",          _iterations,          _iterationsSet         ) ) { return; }
+        if(checkSizeTParam(param,   "warmup",              _warmup,              _warmupSet             ) ) { return; }
+        if(checkCacheParam(param) ) { return; }
+        if(checkStringParam(param,  "attrs",               _attrs,               _attrsSet              ) ) { return; }
+        if(checkStringParam(param,  "box",                 _box,                 _boxSet                ) ) { return; }
+        if(checkDoubleParam(param,  "sample",              _sample,              _sampleSet             ) ) { return; }
+        if(checkOrderParam(param) ) { return; }
+        if(checkEngineParam(param) ) { return; }
+        if(checkSizeTParam(param,   "queue_depth",         _queueDepth,          _queueDepthSet         ) ) { return; }
+        if(checkBoolParam (param,   "file_direct",         _fileDirect,          _fileDirectSet         ) ) { return; }
+        if(checkSizeTParam(param,   "batch_bytes",         _batchBytes,          _batchBytesSet         ) ) { return; }
+        if(checkBoolParam (param,   "huge_pages",          _hugePages,           _hugePagesSet          ) ) { return; }
+        if(checkNumaParam(param) ) { return; }
+        if(checkBoolParam (param,   "pin",                 _pin,                 _pinSet                ) ) { return; }
+        if(checkDoubleParam(param,  "consume_rate",        _consumeRate,         _consumeRateSet        ) ) { return; }
+        if(checkDoubleParam(param,  "consume_delay",       _consumeDelay,        _consumeDelaySet       ) ) { return; }
+        if(checkStringParam(param,  "sweep",               _sweep,               _sweepSet              ) ) { return; }
+        ostringstream error;
+        error<<"unrecognized parameter "<<param;
+        throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+    }
+public:
+    /*
+     * In trace mode every instance returns one cell per chunk it read, at
+     * [inst, attid, chunk_no] where chunk_no counts that instance's chunks of the attribute.
+     */
+    static const int64_t TRACE_CHUNK_SIZE = 100000;
+
+    static const int64_t TRANSFER_RING = -1;
+
+    /*
+     * A batch's value size is stored in 32 bits; a batch may overshoot batch_bytes by a chunk.
+     */
+    static const size_t MAX_BATCH_BYTES = 1024 * 1024 * 1024;
+
+    static const int COMPRESS_OWN = -1;
+
+    static string nodeColumnName(size_t const node)
+    {
+        ostringstream name;
+        name<<"node"<<node<<"_bytes";
+        return name.str();
+    }
+
+    /*
+     * The summary's per-node columns, and the layout of the summaries instances exchange, follow
+     * the coordinator's node count. Fail on a host with a different count rather than misplace
+     * its bytes. Trace, transfer and sweep rows don't report nodes.
+     */
+    void checkNumaNodes(ArrayDesc const& schema) const
+    {
+        if(!numaflag() || traceflag() || transferflag() || sweepflag())
+        {
+            return;
+        }
+        size_t schemaNodes = 0;
+        Attributes const& attributes = schema.getAttributes();
+        for(size_t i = 0; i<attributes.size(); ++i)
+        {
+            if(attributes[i].getName() == nodeColumnName(schemaNodes))
+            {
+                ++schemaNodes;
+            }
+        }
+        if(schemaNodes != _numNumaNodes)
+        {
+            ostringstream error;
+            error<<"this host has "<<_numNumaNodes<<" numa nodes and the coordinator's has "<<schemaNodes<<"; numa needs the same count on every host";
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+        }
+    }
+
+    ArrayDesc getTraceSchema(shared_ptr<Query>& query)
+    {
+        vector<DimensionDesc> dimensions(3);
+        dimensions[0] = DimensionDesc("inst",     0, 0, _numInstances-1,       _numInstances-1,       1,                   0);
+        dimensions[1] = DimensionDesc("attid",    0, 0, _numInputAttributes-1, _numInputAttributes-1, 1,                   0);
+        dimensions[2] = DimensionDesc("chunk_no", 0, 0, CoordinateBounds::getMax(), CoordinateBounds::getMax(), TRACE_CHUNK_SIZE, 0);
+        vector<AttributeDesc> attributes;
+        addOutputAttribute(attributes, "att",                   TID_STRING);
+        //a dimension called no would give chunk_no twice; such names get underscores until unique
+        std::set<string> taken = { "inst", "attid", "chunk_no", "att", "bytes", "cells", "start_ns", "duration_ns" };
+        for(size_t i = 0; i<_inputDimensionNames.size(); ++i)
+        {
+            string name = "chunk_" + _inputDimensionNames[i];
+            while(taken.count(name))
+            {
+                name += "_";
+            }
+            taken.insert(name);
+            addOutputAttribute(attributes, name, TID_INT64);
+        }
+        addOutputAttribute(attributes, "bytes",                 TID_UINT64);
+        addOutputAttribute(attributes, "cells",                 TID_UINT64);
+        addOutputAttribute(attributes, "start_ns",              TID_INT64);
+        addOutputAttribute(attributes, "duration_ns",           TID_INT64);
+        attributes = addEmptyTagAttribute(attributes);
+        return ArrayDesc("pull", attributes, dimensions, defaultPartitioning(), query->getDefaultArrayResidency());
+    }
+
+    /*
+     * In transfer mode every instance returns one cell per peer it exchanged chunks with, at
+     * [inst, peer].
+     */
+    ArrayDesc getTransferSchema(shared_ptr<Query>& query)
+    {
+        vector<DimensionDesc> dimensions(2);
+        dimensions[0] = DimensionDesc("inst", 0, 0, _numInstances-1, _numInstances-1, 1,             0);
+        dimensions[1] = DimensionDesc("peer", 0, 0, _numInstances-1, _numInstances-1, _numInstances, 0);
+        vector<AttributeDesc> attributes;
+        addOutputAttribute(attributes, "sent_bytes",                TID_UINT64);
+        addOutputAttribute(attributes, "sent_messages",             TID_UINT64);
+        addOutputAttribute(attributes, "send_seconds",              TID_DOUBLE);
+        addOutputAttribute(attributes, "received_bytes",            TID_UINT64);
+        addOutputAttribute(attributes, "received_messages",         TID_UINT64);
+        addOutputAttribute(attributes, "receive_seconds",           TID_DOUBLE);
+        addOutputAttribute(attributes, "link_seconds",              TID_DOUBLE);
+        addOutputAttribute(attributes, "sent_bytes_per_second",     TID_DOUBLE);
+        addOutputAttribute(attributes, "received_bytes_per_second", TID_DOUBLE);
+        attributes = addEmptyTagAttribute(attributes);
+        return ArrayDesc("pull", attributes, dimensions, defaultPartitioning(), query->getDefaultArrayResidency());
+    }
+
+    /*
+     * In sweep mode every instance returns one cell per thread count, at [inst, threads].
+     */
+    ArrayDesc getSweepSchema(shared_ptr<Query>& query)
+    {
+        int64_t const maxThreads = _sweepLevels.back();
+        vector<DimensionDesc> dimensions(2);
+        dimensions[0] = DimensionDesc("inst",    0, 0, _numInstances-1, _numInstances-1, 1,              0);
+        dimensions[1] = DimensionDesc("threads", 0, 0, maxThreads,      maxThreads,      maxThreads + 1, 0);
+        vector<AttributeDesc> attributes;
+        addOutputAttribute(attributes, "workers",               TID_UINT64);
+        addOutputAttribute(attributes, "read_bytes",            TID_UINT64);
+        addOutputAttribute(attributes, "wall_seconds",          TID_DOUBLE);
+        addOutputAttribute(attributes, "wall_bytes_per_second", TID_DOUBLE);
+        addOutputAttribute(attributes, "efficiency",            TID_DOUBLE);
+        addOutputAttribute(attributes, "p99_chunk_seconds",     TID_DOUBLE);
+        attributes = addEmptyTagAttribute(attributes);
+        return ArrayDesc("pull", attributes, dimensions, defaultPartitioning(), query->getDefaultArrayResidency());
+    }
+
+    ArrayDesc getSchema(shared_ptr<Query>& query)
+    {
+        if(traceflag())
+        {
+            return getTraceSchema(query);
+        }
+        if(sweepflag())
+        {
+            return getSweepSchema(query);
+        }
+        if(transferflag())
+        {
+            return getTransferSchema(query);
+        }
+        vector<DimensionDesc> dimensions(2);
+        //the attribute x instance matrix has a total row and column
+        size_t const margin = _perAttribute && _perInstance ? 1 : 0;
+        dimensions[0] = DimensionDesc("inst",  0, 0, _numInstances-1+margin,       _numInstances-1+margin,       1,                          0);
+        dimensions[1] = DimensionDesc("attid", 0, 0, _numInputAttributes-1+margin, _numInputAttributes-1+margin, _numInputAttributes+margin, 0);
+        vector<AttributeDesc> attributes;
+        addOutputAttribute(attributes, "att",                   TID_STRING);
+        addOutputAttribute(attributes, "read_bytes",            TID_UINT64);
+        addOutputAttribute(attributes, "total_seconds",         TID_DOUBLE);
+        addOutputAttribute(attributes, "bytes_per_second",      TID_DOUBLE);
+        if(accessflag())
+        {
+            addOutputAttribute(attributes, "cells",             TID_UINT64);
+            addOutputAttribute(attributes, "cells_per_second",  TID_DOUBLE);
+        }
+        addOutputAttribute(attributes, "wall_seconds",          TID_DOUBLE);
+        addOutputAttribute(attributes, "wall_bytes_per_second", TID_DOUBLE);
+        addOutputAttribute(attributes, "chunks",                TID_UINT64);
+        addOutputAttribute(attributes, "min_chunk_seconds",     TID_DOUBLE);
+        addOutputAttribute(attributes, "p50_chunk_seconds",     TID_DOUBLE);
+        addOutputAttribute(attributes, "p90_chunk_seconds",     TID_DOUBLE);
+        addOutputAttribute(attributes, "p99_chunk_seconds",     TID_DOUBLE);
+        addOutputAttribute(attributes, "max_chunk_seconds",     TID_DOUBLE);
+        addOutputAttribute(attributes, "reduce_seconds",        TID_DOUBLE);
+        if(stageTimingflag())
+        {
+            addOutputAttribute(attributes, "fetch_seconds",     TID_DOUBLE);
+            addOutputAttribute(attributes, "consume_seconds",   TID_DOUBLE);
+            addOutputAttribute(attributes, "stall_seconds",     TID_DOUBLE);
+        }
+        if(_sink == SINK_CHECKSUM)
+        {
+            addOutputAttribute(attributes, "digest",            TID_UINT64);
+        }
+        if(sinkStallflag())
+        {
+            addOutputAttribute(attributes, "sink_stall_seconds", TID_DOUBLE);
+        }
+        if(batchflag())
+        {
+            addOutputAttribute(attributes, "batches",                  TID_UINT64);
+            addOutputAttribute(attributes, "batch_seconds",            TID_DOUBLE);
+            addOutputAttribute(attributes, "batched_bytes_per_second", TID_DOUBLE);
+        }
+        for(size_t c = 0; c<_compressorNames.size(); ++c)
+        {
+            addOutputAttribute(attributes, _compressorNames[c] + "compressed_bytes",          TID_UINT64);
+            addOutputAttribute(attributes, _compressorNames[c] + "compress_ratio",            TID_DOUBLE);
+            addOutputAttribute(attributes, _compressorNames[c] + "compress_seconds",          TID_DOUBLE);
+            addOutputAttribute(attributes, _compressorNames[c] + "compress_bytes_per_second", TID_DOUBLE);
+        }
+        if(breakdownflag())
+        {
+            for(size_t p = 0; p<NUM_PHASES; ++p)
+            {
+                addOutputAttribute(attributes, string(PHASE_NAMES[p]) + "_seconds", TID_DOUBLE);
+                addOutputAttribute(attributes, string(PHASE_NAMES[p]) + "_pct",     TID_DOUBLE);
+            }
+            addOutputAttribute(attributes, "allocations",      TID_UINT64);
+            addOutputAttribute(attributes, "allocated_bytes",  TID_UINT64);
+        }
+        if(countersflag())
+        {
+            for(size_t c = 0; c<NUM_COUNTERS; ++c)
+            {
+                addOutputAttribute(attributes, COUNTER_NAMES[c], TID_UINT64);
+            }
+            addOutputAttribute(attributes, "instructions_per_cycle", TID_DOUBLE);
+        }
+        if(fetchCountersflag())
+        {
+            for(size_t c = 0; c<NUM_COUNTERS; ++c)
+            {
+                addOutputAttribute(attributes, string("fetch_") + COUNTER_NAMES[c], TID_UINT64);
+            }
+            addOutputAttribute(attributes, "fetch_instructions_per_cycle", TID_DOUBLE);
+        }
+        for(size_t n = 0; n<_numNumaNodes; ++n)
+        {
+            addOutputAttribute(attributes, nodeColumnName(n), TID_UINT64);
+        }
+        if(selectionflag())
+        {
+            addOutputAttribute(attributes, "full_scan_seconds",            TID_DOUBLE);
+        }
+        if(directflag())
+        {
+            addOutputAttribute(attributes, "direct_bytes",                 TID_UINT64);
+            addOutputAttribute(attributes, "direct_seconds",               TID_DOUBLE);
+            addOutputAttribute(attributes, "direct_bytes_per_second",      TID_DOUBLE);
+        }
+        if(fileflag())
+        {
+            addOutputAttribute(attributes, "file_bytes",                   TID_UINT64);
+            addOutputAttribute(attributes, "file_write_seconds",           TID_DOUBLE);
+            addOutputAttribute(attributes, "file_fsync_seconds",           TID_DOUBLE);
+            addOutputAttribute(attributes, "file_bytes_per_second",        TID_DOUBLE);
+        }
+        if(consumeRateflag())
+        {
+            addOutputAttribute(attributes, "consumer_starved_seconds",     TID_DOUBLE);
+            addOutputAttribute(attributes, "consumer_seconds",             TID_DOUBLE);
+            addOutputAttribute(attributes, "delivered_bytes_per_second",   TID_DOUBLE);
+        }
+        if(repeatflag())
+        {
+            addOutputAttribute(attributes, "iterations",                   TID_UINT64);
+            addOutputAttribute(attributes, "mean_wall_seconds",            TID_DOUBLE);
+            addOutputAttribute(attributes, "stddev_wall_seconds",          TID_DOUBLE);
+            addOutputAttribute(attributes, "min_wall_seconds",             TID_DOUBLE);
+            addOutputAttribute(attributes, "max_wall_seconds",             TID_DOUBLE);
+            addOutputAttribute(attributes, "mean_wall_bytes_per_second",   TID_DOUBLE);
+            addOutputAttribute(attributes, "stddev_wall_bytes_per_second", TID_DOUBLE);
+            addOutputAttribute(attributes, "min_wall_bytes_per_second",    TID_DOUBLE);
+            addOutputAttribute(attributes, "max_wall_bytes_per_second",    TID_DOUBLE);
+        }
+        attributes = addEmptyTagAttribute(attributes);
+        return ArrayDesc("pull", attributes, dimensions, defaultPartitioning(), query->getDefaultArrayResidency());
+    }
+
+private:
+    static void addOutputAttribute(vector<AttributeDesc>& attributes, string const& name, TypeId const& type)
+    {
+        attributes.push_back(AttributeDesc((AttributeID) attributes.size(), name, type, AttributeDesc::IS_NULLABLE, 0));
+    }
+
+public:
+
+    size_t numInputAttributes() const
+    {
+        return _numInputAttributes;
+    }
+    bool perAttributeflag() const
+    {
+        return _perAttribute;
+    }
+    bool perInstanceflag() const
+    {
+        return _perInstance;
+    }
+    size_t numThreads() const
+    {
+        return _threads;
+    }
+    size_t numRanges() const
+    {
+        return _ranges;
+    }
+    size_t prefetchDepth() const
+    {
+        return _prefetch;
+    }
+    /*
+     * Fetch and consume are timed separately whenever prefetch is given, including prefetch=0, so
+     * that a serial run can be compared against a pipelined one.
+     */
+    bool stageTimingflag() const
+    {
+        return _prefetchSet;
+    }
+    /*
+     * With counters and a producer thread, the producer's fetching is counted on its own.
+     */
+    bool fetchCountersflag() const
+    {
+        return _counters && _prefetch > 0;
+    }
+    bool breakdownflag() const
+    {
+        return _breakdown;
+    }
+    SinkType sinkType() const
+    {
+        return _sink;
+    }
+    /*
+     * The name given to sink=shm:<name>, or the path given to sink=file:<path>.
+     */
+    string const& sinkTarget() const
+    {
+        return _sinkTarget;
+    }
+    /*
+     * The sink hands chunks to something that can make the workers wait.
+     */
+    bool sinkStallflag() const
+    {
+        return _sink == SINK_SHM || _sink == SINK_FILE || consumeRateflag();
+    }
+    /*
+     * With consume_rate the chunks are handed to an emulated consumer that takes that many bytes
+     * per second per instance, and consume_delay seconds more per chunk.
+     */
+    bool consumeRateflag() const
+    {
+        return _consumeRateSet;
+    }
+    double consumeRate() const
+    {
+        return _consumeRate;
+    }
+    double consumeDelay() const
+    {
+        return _consumeDelay;
+    }
+    bool fileflag() const
+    {
+        return _sink == SINK_FILE;
+    }
+    bool fileDirectflag() const
+    {
+        return _fileDirect;
+    }
+    /*
+     * With batch_bytes the payloads of each attribute are coalesced into batches of at least
+     * that many bytes.
+     */
+    bool batchflag() const
+    {
+        return _batchBytesSet;
+    }
+    size_t batchBytes() const
+    {
+        return _batchBytes;
+    }
+    /*
+     * Back the workers' staging buffers with 2MB pages.
+     */
+    bool hugePagesflag() const
+    {
+        return _hugePages;
+    }
+    /*
+     * With numa= or pin= the bytes read are also counted by the NUMA node they were read on.
+     */
+    bool numaflag() const
+    {
+        return _numaSet || _pinSet;
+    }
+    NumaPolicy numaPolicy() const
+    {
+        return _numa;
+    }
+    size_t numaNode() const
+    {
+        return _numaNode;
+    }
+    bool pinflag() const
+    {
+        return _pin;
+    }
+    size_t numNumaNodes() const
+    {
+        return _numNumaNodes;
+    }
+    bool traceflag() const
+    {
+        return _trace;
+    }
+    bool sweepflag() const
+    {
+        return _sweepSet;
+    }
+    /*
+     * In increasing order.
+     */
+    vector<size_t> const& sweepLevels() const
+    {
+        return _sweepLevels;
+    }
+    bool transferflag() const
+    {
+        return _transferSet;
+    }
+    /*
+     * The instance every other instance ships its chunks to, or TRANSFER_RING when each instance
+     * ships to the next one.
+     */
+    int64_t transferTarget() const
+    {
+        return _transferTarget;
+    }
+    /*
+     * Cells are counted, and cells per second reported, whenever access is given.
+     */
+    bool accessflag() const
+    {
+        return _accessSet;
+    }
+    AccessType accessType() const
+    {
+        return _access;
+    }
+    bool countersflag() const
+    {
+        return _counters;
+    }
+    size_t numIterations() const
+    {
+        return _iterations;
+    }
+    /*
+     * Unmeasured iterations run first. cache=warm implies one unless warmup is given.
+     */
+    size_t numWarmup() const
+    {
+        return _warmup;
+    }
+    CacheMode cacheMode() const
+    {
+        return _cache;
+    }
+    /*
+     * Per-iteration statistics are reported whenever iterations, warmup or cache is given.
+     */
+    bool repeatflag() const
+    {
+        return _iterationsSet || _warmupSet || _cacheSet;
+    }
+    vector<AttributeID> const& selectedAttributes() const
+    {
+        return _selectedAttributes;
+    }
+    bool attributeSelected(AttributeID const att) const
+    {
+        return std::find(_selectedAttributes.begin(), _selectedAttributes.end(), att) != _selectedAttributes.end();
+    }
+    /*
+     * Only some of the chunk positions are read, so the wall time is extrapolated to a full scan.
+     */
+    bool selectionflag() const
+    {
+        return _boxSet || _sampleSet;
+    }
+    /*
+     * Whether to read the chunk at chunkPosition: it must overlap the box, and its position must
+     * hash below the sample fraction. The hash only depends on the position, so every attribute,
+     * instance and run picks the same chunks.
+     */
+    bool chunkSelected(Coordinates const& chunkPosition) const
+    {
+        for(size_t d = 0; d<_boxLow.size(); ++d)
+        {
+            if(chunkPosition[d] > _boxHigh[d] || chunkPosition[d] + _chunkIntervals[d] - 1 < _boxLow[d])
+            {
+                return false;
+            }
+        }
+        if(_sampleSet)
+        {
+            uint64_t h = BIG_CONSTANT(0x9e3779b97f4a7c15);
+            for(size_t d = 0; d<chunkPosition.size(); ++d)
+            {
+                h = fmix(h ^ (uint64_t) chunkPosition[d]);
+            }
+            return h < _sample * 18446744073709551616.0;
+        }
+        return true;
+    }
+    /*
+     * With order= the chunk positions are collected first and visited with setPosition.
+     */
+    bool orderflag() const
+    {
+        return _orderSet;
+    }
+    VisitOrder visitOrder() const
+    {
+        return _order;
+    }
+    size_t orderStride() const
+    {
+        return _orderStride;
+    }
+    /*
+     * With engine=direct the instance's storage files are also read raw, after the iterator
+     * passes, with queueDepth reads in flight.
+     */
+    bool directflag() const
+    {
+        return _engine == ENGINE_DIRECT;
+    }
+    size_t queueDepth() const
+    {
+        return _queueDepth;
+    }
+    size_t numCompressors() const
+    {
+        return _compressorTypes.size();
+    }
+    /*
+     * The CompressorFactory type of the k-th compressor to time, or COMPRESS_OWN for whatever the
+     * chunk's attribute is stored with.
+     */
+    int compressorType(size_t const k) const
+    {
+        return _compressorTypes[k];
+    }
+
+};
+
+/*
+ * Doubles travel in summaries bit for bit, as 8-byte words.
+ */
+inline uint64_t podWord(double const value)
+{
+    uint64_t word;
+    memcpy(&word, &value, sizeof(word));
+    return word;
+}
+
+inline double podDouble(uint64_t const word)
+{
+    double value;
+    memcpy(&value, &word, sizeof(value));
+    return value;
+}
+
+struct SummaryTuple
+{
+public:
+	string attName;
+    ssize_t readBytes;
+    double totalSeconds;
+    double bytesPerSecond;
+    double wallSeconds;
+    double fetchSeconds;
+    double consumeSeconds;
+    double stallSeconds;
+    LatencyHistogram chunkLatency;
+    vector<double> phaseSeconds;
+    uint64_t digest;
+    uint64_t cells;
+    vector<uint64_t> counters;
+    uint64_t countersMissing;           //bit per PullCounter that some contributing thread couldn't open
+    vector<uint64_t> fetchCounters;     //prefetch producers' counts; the above are the consumers'
+    uint64_t fetchCountersMissing;
+    vector<uint64_t> compressedBytes;   //one per compressor timed
+    vector<double> compressSeconds;
+    vector<uint64_t> nodeBytes;         //with numa or pin: bytes read on each NUMA node
+    vector<uint64_t> iterationBytes;    //one per measured iteration
+    vector<double> iterationWall;
+    double fullScanSeconds;             //with box or sample: estimated wall time of one unselective scan, negative if unknown
+    uint64_t directBytes;               //engine=direct: storage file bytes read raw, instance totals only
+    double directSeconds;               //negative if not measured
+    double sinkStallSeconds;            //time the sink waited on its consumer
+    uint64_t allocations;               //staging memory the workers' arenas took from the system
+    uint64_t allocatedBytes;
+    uint64_t batches;                   //batch_bytes: batches formed
+    uint64_t batchedBytes;              //payload bytes handed over in those batches
+    double batchSeconds;                //time spent coalescing
+    uint64_t fileBytes;                 //sink=file: bytes written, instance totals only
+    double fileWriteSeconds;            //negative if not measured
+    double fileFsyncSeconds;
+    uint64_t consumerBytes;             //consume_rate: bytes the consumer took, instance totals only
+    double consumerSeconds;             //until it was done with them; negative if not measured
+    double consumerStarvedSeconds;      //of which it sat waiting for data
+
+    SummaryTuple(string att = ""):
+        attName(att),
+        readBytes(0),
+        totalSeconds(0),
+        bytesPerSecond(0),
+        wallSeconds(0),
+        fetchSeconds(0),
+        consumeSeconds(0),
+        stallSeconds(0),
+        phaseSeconds(NUM_PHASES, 0),
+        digest(0),
+        cells(0),
+        counters(NUM_COUNTERS, 0),
+        countersMissing(0),
+        fetchCounters(NUM_COUNTERS, 0),
+        fetchCountersMissing(0),
+        fullScanSeconds(-1),
+        directBytes(0),
+        directSeconds(-1),
+        sinkStallSeconds(0),
+        allocations(0),
+        allocatedBytes(0),
+        batches(0),
+        batchedBytes(0),
+        batchSeconds(0),
+        fileBytes(0),
+        fileWriteSeconds(-1),
+        fileFsyncSeconds(-1),
+        consumerBytes(0),
+        consumerSeconds(-1),
+        consumerStarvedSeconds(-1)
+    {}
+
+    /*
+     * Add up everything that accumulates; wall time is left alone.
+     */
+    void add(SummaryTuple const& other)
+    {
+        readBytes      += other.readBytes;
+        totalSeconds   += other.totalSeconds;
+        fetchSeconds   += other.fetchSeconds;
+        consumeSeconds += other.consumeSeconds;
+        stallSeconds   += other.stallSeconds;
+        chunkLatency.merge(other.chunkLatency);
+        for(size_t p = 0; p<NUM_PHASES; ++p)
+        {
+            phaseSeconds[p] += other.phaseSeconds[p];
+        }
+        digest += other.digest;
+        cells  += other.cells;
+        sinkStallSeconds += other.sinkStallSeconds;
+        allocations      += other.allocations;
+        allocatedBytes   += other.allocatedBytes;
+        batches          += other.batches;
+        batchedBytes     += other.batchedBytes;
+        batchSeconds     += other.batchSeconds;
+        for(size_t c = 0; c<NUM_COUNTERS; ++c)
+        {
+            counters[c] += other.counters[c];
+        }
+        countersMissing |= other.countersMissing;
+        for(size_t c = 0; c<NUM_COUNTERS; ++c)
+        {
+            fetchCounters[c] += other.fetchCounters[c];
+        }
+        fetchCountersMissing |= other.fetchCountersMissing;
+        if(compressedBytes.size() < other.compressedBytes.size())
+        {
+            compressedBytes.resize(other.compressedBytes.size(), 0);
+            compressSeconds.resize(other.compressSeconds.size(), 0);
+        }
+        for(size_t c = 0; c<other.compressedBytes.size(); ++c)
+        {
+            compressedBytes[c] += other.compressedBytes[c];
+            compressSeconds[c] += other.compressSeconds[c];
+        }
+        if(nodeBytes.size() < other.nodeBytes.size())
+        {
+            nodeBytes.resize(other.nodeBytes.size(), 0);
+        }
+        for(size_t n = 0; n<other.nodeBytes.size(); ++n)
+        {
+            nodeBytes[n] += other.nodeBytes[n];
+        }
+        if(iterationBytes.size() < other.iterationBytes.size())
+        {
+            iterationBytes.resize(other.iterationBytes.size(), 0);
+            iterationWall.resize(other.iterationWall.size(), 0);
+        }
+        for(size_t i = 0; i<other.iterationBytes.size(); ++i)
+        {
+            iterationBytes[i] += other.iterationBytes[i];
+        }
+    }
+
+    /*
+     * Size of a tuple's wire form in 8-byte words, less the histogram's bucket counts, which
+     * come last and only cover the buckets in use. Everything else only depends on the settings,
+     * so every instance agrees on it without sending names or lengths.
+     */
+    static size_t fixedPodWords(Settings const& settings)
+    {
+        return 25 + NUM_PHASES + 2 * NUM_COUNTERS + 2 * settings.numCompressors() + settings.numNumaNodes() + 2 * settings.numIterations() + LatencyHistogram::POD_HEADER_WORDS;
+    }
+
+    void toPod(vector<uint64_t>& out, Settings const& settings) const
+    {
+        size_t const numCompressors = settings.numCompressors();
+        out.push_back(readBytes);
+        out.push_back(podWord(totalSeconds));
+        out.push_back(podWord(wallSeconds));
+        out.push_back(podWord(fetchSeconds));
+        out.push_back(podWord(consumeSeconds));
+        out.push_back(podWord(stallSeconds));
+        out.push_back(digest);
+        out.push_back(cells);
+        out.push_back(countersMissing);
+        out.push_back(fetchCountersMissing);
+        out.push_back(podWord(fullScanSeconds));
+        out.push_back(directBytes);
+        out.push_back(podWord(directSeconds));
+        out.push_back(podWord(sinkStallSeconds));
+        out.push_back(allocations);
+        out.push_back(allocatedBytes);
+        out.push_back(batches);
+        out.push_back(batchedBytes);
+        out.push_back(podWord(batchSeconds));
+        out.push_back(fileBytes);
+        out.push_back(podWord(fileWriteSeconds));
+        out.push_back(podWord(fileFsyncSeconds));
+        out.push_back(consumerBytes);
+        out.push_back(podWord(consumerSeconds));
+        out.push_back(podWord(consumerStarvedSeconds));
+        for(size_t p = 0; p<NUM_PHASES; ++p)
+        {
+            out.push_back(podWord(phaseSeconds[p]));
+        }
+        out.insert(out.end(), counters.begin(), counters.end());
+        out.insert(out.end(), fetchCounters.begin(), fetchCounters.end());
+        for(size_t c = 0; c<numCompressors; ++c)
+        {
+            out.push_back(c < compressedBytes.size() ? compressedBytes[c] : 0);
+            out.push_back(podWord(c < compressSeconds.size() ? compressSeconds[c] : 0));
+        }
+        for(size_t n = 0; n<settings.numNumaNodes(); ++n)
+        {
+            out.push_back(n < nodeBytes.size() ? nodeBytes[n] : 0);
+        }
+        for(size_t i = 0; i<settings.numIterations(); ++i)
+        {
+            out.push_back(i < iterationBytes.size() ? iterationBytes[i] : 0);
+            out.push_back(podWord(i < iterationWall.size() ? iterationWall[i] : 0));
+        }
+        chunkLatency.toPod(out);
+    }
+
+    /*
+     * Read a tuple written by toPod, leaving in just past it. The name isn't sent; the reader
+     * already has it.
+     */
+    void fromPod(uint64_t const*& in, uint64_t const* end, Settings const& settings)
+    {
+        if(end - in < (ptrdiff_t) fixedPodWords(settings))
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "mismatched summary sizes across instances";
+        }
+        size_t const numCompressors = settings.numCompressors();
+        readBytes       = *in++;
+        totalSeconds    = podDouble(*in++);
+        wallSeconds     = podDouble(*in++);
+        fetchSeconds    = podDouble(*in++);
+        consumeSeconds  = podDouble(*in++);
+        stallSeconds    = podDouble(*in++);
+        digest          = *in++;
+        cells           = *in++;
+        countersMissing = *in++;
+        fetchCountersMissing = *in++;
+        fullScanSeconds = podDouble(*in++);
+        directBytes     = *in++;
+        directSeconds   = podDouble(*in++);
+        sinkStallSeconds = podDouble(*in++);
+        allocations      = *in++;
+        allocatedBytes   = *in++;
+        batches          = *in++;
+        batchedBytes     = *in++;
+        batchSeconds     = podDouble(*in++);
+        fileBytes        = *in++;
+        fileWriteSeconds = podDouble(*in++);
+        fileFsyncSeconds = podDouble(*in++);
+        consumerBytes    = *in++;
+        consumerSeconds  = podDouble(*in++);
+        consumerStarvedSeconds = podDouble(*in++);
+        for(size_t p = 0; p<NUM_PHASES; ++p)
+        {
+            phaseSeconds[p] = podDouble(*in++);
+        }
+        for(size_t c = 0; c<NUM_COUNTERS; ++c)
+        {
+            counters[c] = *in++;
+        }
+        for(size_t c = 0; c<NUM_COUNTERS; ++c)
+        {
+            fetchCounters[c] = *in++;
+        }
+        compressedBytes.resize(numCompressors);
+        compressSeconds.resize(numCompressors);
+        for(size_t c = 0; c<numCompressors; ++c)
+        {
+            compressedBytes[c] = *in++;
+            compressSeconds[c] = podDouble(*in++);
+        }
+        nodeBytes.resize(settings.numNumaNodes());
+        for(size_t n = 0; n<settings.numNumaNodes(); ++n)
+        {
+            nodeBytes[n] = *in++;
+        }
+        iterationBytes.resize(settings.numIterations());
+        iterationWall.resize(settings.numIterations());
+        for(size_t i = 0; i<settings.numIterations(); ++i)
+        {
+            iterationBytes[i] = *in++;
+            iterationWall[i]  = podDouble(*in++);
+        }
+        if(!chunkLatency.fromPod(in, end))
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "mismatched summary sizes across instances";
+        }
+    }
+
+    /*
+     * Fold in a tuple that was measured concurrently with this one (another thread or instance):
+     * time spent reading adds up, wall-clock time overlaps.
+     */
+    void merge(SummaryTuple const& other)
+    {
+        add(other);
+        wallSeconds = std::max(wallSeconds, other.wallSeconds);
+        fullScanSeconds = std::max(fullScanSeconds, other.fullScanSeconds);
+        directBytes    += other.directBytes;
+        directSeconds   = std::max(directSeconds, other.directSeconds);
+        fileBytes      += other.fileBytes;
+        fileWriteSeconds = std::max(fileWriteSeconds, other.fileWriteSeconds);
+        fileFsyncSeconds = std::max(fileFsyncSeconds, other.fileFsyncSeconds);
+        consumerBytes  += other.consumerBytes;
+        consumerSeconds = std::max(consumerSeconds, other.consumerSeconds);
+        consumerStarvedSeconds = std::max(consumerStarvedSeconds, other.consumerStarvedSeconds);
+        for(size_t i = 0; i<other.iterationWall.size(); ++i)
+        {
+            iterationWall[i] = std::max(iterationWall[i], other.iterationWall[i]);
+        }
+    }
+};
+
+/*
+ * One chunk read, as reported by trace=true.
+ */
+struct ChunkTrace
+{
+    AttributeID att;
+    Coordinates position;
+    uint64_t    bytes;
+    uint64_t    cells;
+    double      start;      //seconds since the instance started pulling
+    double      duration;
+
+    bool operator<(ChunkTrace const& other) const
+    {
+        return att != other.att ? att < other.att : start < other.start;
+    }
+};
+
+/*
+ * One thread count of sweep=, totalled over the attributes of one instance. workers can fall
+ * short of threads when there are fewer tasks than that.
+ */
+struct SweepLevel
+{
+    size_t       threads;
+    size_t       workers;
+    SummaryTuple total;
+
+    SweepLevel(size_t const threads, size_t const workers, SummaryTuple const& total):
+        threads(threads),
+        workers(workers),
+        total(total)
+    {}
+};
+
+/*
+ * What one instance saw of its link to one peer in transfer mode. Times are in seconds since the
+ * instance started pulling; start and end bracket the first and last message on the link.
+ */
+struct LinkStats
+{
+    uint64_t sentBytes;
+    uint64_t sentMessages;
+    double   sendSeconds;
+    uint64_t receivedBytes;
+    uint64_t receivedMessages;
+    double   receiveSeconds;
+    double   start;
+    double   end;
+
+    LinkStats():
+        sentBytes(0),
+        sentMessages(0),
+        sendSeconds(0),
+        receivedBytes(0),
+        receivedMessages(0),
+        receiveSeconds(0),
+        start(std::numeric_limits<double>::max()),
+        end(0)
+    {}
+
+    bool used() const
+    {
+        return end > 0;
+    }
+
+    void touch(double const from, double const to)
+    {
+        start = std::min(start, from);
+        end   = std::max(end, to);
+    }
+};
+
+/*
+ * Accumulators owned by a single pull worker thread. No two workers share one, so the read loop
+ * needs no locking; InstanceSummary::addThreadSummary folds them together after the workers join.
+ * Chunk start/end times are in seconds since the instance started pulling.
+ */
+struct ThreadSummary
+{
+    vector<SummaryTuple> summaryData;
+    vector<double>       windowStart;
+    vector<double>       windowEnd;
+    vector<ChunkTrace>   traces;
+
+    ThreadSummary(size_t const numAttributes):
+        summaryData(numAttributes, SummaryTuple()),
+        windowStart(numAttributes, std::numeric_limits<double>::max()),
+        windowEnd(numAttributes, 0)
+    {}
+
+    /*
+     * latency is the chunk's own read time. It is chunkEnd - chunkStart unless the chunk was
+     * fetched ahead, in which case it leaves out the time the chunk waited to be consumed.
+     */
+    void addChunkData(AttributeID attId, ssize_t attBytes, double chunkStart, double chunkEnd, double latency)
+    {
+        SummaryTuple& tuple = summaryData[attId];
+        tuple.readBytes+=attBytes;
+        tuple.totalSeconds+=(chunkEnd - chunkStart);
+        tuple.chunkLatency.record(latency);
+        windowStart[attId] = std::min(windowStart[attId], chunkStart);
+        windowEnd[attId]   = std::max(windowEnd[attId],   chunkEnd);
+    }
+
+    /*
+     * Per-chunk stage timing: fetching and pinning (I/O), consuming (CPU), and how long the
+     * consumer waited for the chunk to be fetched.
+     */
+    void addStageData(AttributeID attId, double fetchSeconds, double consumeSeconds, double stallSeconds)
+    {
+        SummaryTuple& tuple = summaryData[attId];
+        tuple.fetchSeconds   += fetchSeconds;
+        tuple.consumeSeconds += consumeSeconds;
+        tuple.stallSeconds   += stallSeconds;
+    }
+
+    /*
+     * Chunk digests add up mod 2^64, so the total doesn't depend on the order chunks were read in.
+     */
+    void addDigest(AttributeID attId, uint64_t chunkDigest)
+    {
+        summaryData[attId].digest += chunkDigest;
+    }
+
+    void addSinkStall(AttributeID attId, double seconds)
+    {
+        summaryData[attId].sinkStallSeconds += seconds;
+    }
+
+    void addNodeBytes(AttributeID attId, size_t node, uint64_t bytes)
+    {
+        SummaryTuple& tuple = summaryData[attId];
+        if(tuple.nodeBytes.size() <= node)
+        {
+            tuple.nodeBytes.resize(node + 1, 0);
+        }
+        tuple.nodeBytes[node] += bytes;
+    }
+
+    void addAllocations(AttributeID attId, uint64_t allocations, uint64_t allocatedBytes)
+    {
+        SummaryTuple& tuple = summaryData[attId];
+        tuple.allocations    += allocations;
+        tuple.allocatedBytes += allocatedBytes;
+    }
+
+    void addBatchData(AttributeID attId, uint64_t batches, uint64_t batchedBytes, double seconds)
+    {
+        SummaryTuple& tuple = summaryData[attId];
+        tuple.batches      += batches;
+        tuple.batchedBytes += batchedBytes;
+        tuple.batchSeconds += seconds;
+    }
+
+    void addCells(AttributeID attId, uint64_t cells)
+    {
+        summaryData[attId].cells += cells;
+    }
+
+    void addCounters(AttributeID attId, uint64_t const* deltas)
+    {
+        SummaryTuple& tuple = summaryData[attId];
+        for(size_t c = 0; c<NUM_COUNTERS; ++c)
+        {
+            tuple.counters[c] += deltas[c];
+        }
+    }
+
+    /*
+     * Mark counters this thread couldn't open, on every attribute, so that totals that include
+     * its chunks come out NULL rather than short.
+     */
+    void markCountersMissing(uint64_t missing)
+    {
+        for(size_t att = 0; att<summaryData.size(); ++att)
+        {
+            summaryData[att].countersMissing |= missing;
+        }
+    }
+
+    void addFetchCounters(AttributeID attId, uint64_t const* deltas)
+    {
+        SummaryTuple& tuple = summaryData[attId];
+        for(size_t c = 0; c<NUM_COUNTERS; ++c)
+        {
+            tuple.fetchCounters[c] += deltas[c];
+        }
+    }
+
+    void markFetchCountersMissing(uint64_t missing)
+    {
+        for(size_t att = 0; att<summaryData.size(); ++att)
+        {
+            summaryData[att].fetchCountersMissing |= missing;
+        }
+    }
+
+    void addCompressData(AttributeID attId, size_t compressor, size_t compressedBytes, double seconds)
+    {
+        SummaryTuple& tuple = summaryData[attId];
+        if(tuple.compressedBytes.size() <= compressor)
+        {
+            tuple.compressedBytes.resize(compressor + 1, 0);
+            tuple.compressSeconds.resize(compressor + 1, 0);
+        }
+        tuple.compressedBytes[compressor] += compressedBytes;
+        tuple.compressSeconds[compressor] += seconds;
+    }
+
+    void addPhaseData(AttributeID attId, double const* seconds)
+    {
+        SummaryTuple& tuple = summaryData[attId];
+        for(size_t p = 0; p<NUM_PHASES; ++p)
+        {
+            tuple.phaseSeconds[p] += seconds[p];
+        }
+    }
+};
+
+struct InstanceSummary
+{
+    InstanceID myInstanceId;
+    vector<SummaryTuple> summaryData;
+    vector<SummaryTuple> marginalData;  //per_attribute and per_instance: totals over instances, coordinator only
+    vector<double>       windowStart;
+    vector<double>       windowEnd;
+    double               wallSeconds;
+    vector<double>       iterationWalls;
+    double               scanFraction;  //share of the local chunk positions selected; 0 if none of them were
+    double               reduceSeconds; //negative unless this instance reduced the summaries of others
+    uint64_t             directBytes;   //engine=direct only
+    double               directSeconds;
+    uint64_t             fileBytes;     //sink=file only, summed over iterations
+    double               fileWriteSeconds;
+    double               fileFsyncSeconds;
+    uint64_t             consumerBytes; //consume_rate only, summed over iterations
+    double               consumerSeconds;
+    double               consumerStarvedSeconds;
+    vector<ChunkTrace>   traces;
+    vector<LinkStats>    links;         //indexed by peer instance, transfer mode only
+    vector<SweepLevel>   sweep;         //sweep mode only
+    int64_t              startNanos;    //wall-clock time the instance started pulling, in ns since the epoch
+
+    InstanceSummary(InstanceID iid,
+                    size_t const numAttributes,
+                    vector<string> attNames):
+        myInstanceId(iid),
+        summaryData(numAttributes,SummaryTuple()),
+        windowStart(numAttributes, std::numeric_limits<double>::max()),
+        windowEnd(numAttributes, 0),
+        wallSeconds(0),
+        scanFraction(1),
+        reduceSeconds(-1),
+        directBytes(0),
+        directSeconds(-1),
+        fileBytes(0),
+        fileWriteSeconds(-1),
+        fileFsyncSeconds(-1),
+        consumerBytes(0),
+        consumerSeconds(-1),
+        consumerStarvedSeconds(-1),
+        startNanos(0)
+    {
+        for(size_t i =0; i<numAttributes; ++i)
+        {
+            summaryData[i].attName=attNames[i];
+        }
+    }
+
+    /*
+     * Add one worker's accumulators. An attribute's wall time runs from the first chunk any thread
+     * started on it to the last chunk any thread finished.
+     */
+    void addThreadSummary(ThreadSummary const& threadSummary)
+    {
+        for(size_t att = 0; att<summaryData.size(); ++att)
+        {
+            summaryData[att].add(threadSummary.summaryData[att]);
+            windowStart[att] = std::min(windowStart[att], threadSummary.windowStart[att]);
+            windowEnd[att]   = std::max(windowEnd[att],   threadSummary.windowEnd[att]);
+            if(windowEnd[att] > windowStart[att])
+            {
+                summaryData[att].wallSeconds = windowEnd[att] - windowStart[att];
+            }
+        }
+        traces.insert(traces.end(), threadSummary.traces.begin(), threadSummary.traces.end());
+    }
+
+    /*
+     * Fold in one measured iteration. Everything adds up, wall time included, except the digest,
+     * which every iteration must agree on. Each tuple keeps its bytes and wall time per
+     * iteration. Traces keep their place on the clock.
+     */
+    void addIteration(InstanceSummary const& iteration)
+    {
+        if(iterationWalls.empty())
+        {
+            startNanos = iteration.startNanos;
+        }
+        double const offset = (iteration.startNanos - startNanos) / 1.0e9;
+        for(size_t att = 0; att<summaryData.size(); ++att)
+        {
+            SummaryTuple const& other = iteration.summaryData[att];
+            //every iteration reads the same data, so the digest is that of one read
+            if(!iterationWalls.empty() && other.digest != summaryData[att].digest)
+            {
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "iterations read data with different digests";
+            }
+            uint64_t const digest = other.digest;
+            summaryData[att].add(other);
+            summaryData[att].digest = digest;
+            summaryData[att].wallSeconds += other.wallSeconds;
+            summaryData[att].iterationBytes.push_back(other.readBytes);
+            summaryData[att].iterationWall.push_back(other.wallSeconds);
+        }
+        wallSeconds += iteration.wallSeconds;
+        iterationWalls.push_back(iteration.wallSeconds);
+        if(iteration.fileWriteSeconds >= 0)
+        {
+            fileBytes        += iteration.fileBytes;
+            fileWriteSeconds  = std::max(fileWriteSeconds, 0.0) + iteration.fileWriteSeconds;
+            fileFsyncSeconds  = std::max(fileFsyncSeconds, 0.0) + iteration.fileFsyncSeconds;
+        }
+        if(iteration.consumerSeconds >= 0)
+        {
+            consumerBytes          += iteration.consumerBytes;
+            consumerSeconds         = std::max(consumerSeconds, 0.0) + iteration.consumerSeconds;
+            consumerStarvedSeconds  = std::max(consumerStarvedSeconds, 0.0) + iteration.consumerStarvedSeconds;
+        }
+        for(size_t i = 0; i<iteration.traces.size(); ++i)
+        {
+            traces.push_back(iteration.traces[i]);
+            traces.back().start += offset;
+        }
+    }
+
+    /*
+     * Collapse the per-attribute tuples into a single "all" tuple. The attributes may have been
+     * read concurrently, so the wall time is that of the whole instance.
+     */
+    void collapseAttributes()
+    {
+        SummaryTuple const instanceSummary = totalOverAttributes();
+        summaryData.clear();
+        summaryData.push_back(instanceSummary);
+    }
+
+    SummaryTuple totalOverAttributes() const
+    {
+        SummaryTuple instanceSummary("all");
+        for(size_t att = 0; att<summaryData.size(); ++att)
+        {
+            instanceSummary.add(summaryData[att]);
+        }
+        instanceSummary.wallSeconds = wallSeconds;
+        instanceSummary.iterationWall = iterationWalls;
+        instanceSummary.fullScanSeconds = estimateFullScan(wallSeconds);
+        instanceSummary.directBytes = directBytes;
+        instanceSummary.directSeconds = directSeconds;
+        instanceSummary.fileBytes = fileBytes;
+        instanceSummary.fileWriteSeconds = fileWriteSeconds;
+        instanceSummary.fileFsyncSeconds = fileFsyncSeconds;
+        instanceSummary.consumerBytes = consumerBytes;
+        instanceSummary.consumerSeconds = consumerSeconds;
+        instanceSummary.consumerStarvedSeconds = consumerStarvedSeconds;
+        return instanceSummary;
+    }
+
+    /*
+     * Scale the wall time of the selected chunks, per iteration, up to all of the local chunks.
+     */
+    double estimateFullScan(double const wall) const
+    {
+        if(scanFraction <= 0)
+        {
+            return -1;
+        }
+        return wall / scanFraction / std::max<size_t>(iterationWalls.size(), 1);
+    }
+
+    /*
+     * Reduce tuples onto the coordinator along a binomial tree, in log2(instances) rounds.
+     * Ranks count from the coordinator; in the round for step, every rank with that bit set
+     * sends what it has accumulated to rank - step and drops out, and rank - step merges it.
+     * Tuples travel in their fixed-layout wire form. Everyone but the coordinator ends up with
+     * no tuples; the coordinator records how long the reduction took, which includes
+     * waiting for the slowest instance to finish reading.
+     */
+    void reduceToCoordinator(vector<SummaryTuple>& tuples, shared_ptr<Query>& query, Settings const& settings)
+    {
+        std::chrono::steady_clock::time_point const reduceStart = std::chrono::steady_clock::now();
+        InstanceID const myId     = query->getInstanceID();
+        InstanceID const coordId  = query->getCoordinatorID() == INVALID_INSTANCE ? myId : query->getCoordinatorID();
+        size_t const numInstances = query->getInstancesCount();
+        size_t const rank         = (myId + numInstances - coordId) % numInstances;
+        size_t const tupleWords   = SummaryTuple::fixedPodWords(settings);
+        for(size_t step = 1; step < numInstances; step <<= 1)
+        {
+            if(rank & step)
+            {
+                vector<uint64_t> words;
+                words.reserve(tuples.size() * (tupleWords + LatencyHistogram::MAX_POD_WORDS));
+                for(size_t att = 0; att<tuples.size(); ++att)
+                {
+                    tuples[att].toPod(words, settings);
+                }
+                shared_ptr<SharedBuffer> bufsend(new MemoryBuffer(&words[0], words.size() * sizeof(uint64_t)));
+                BufSend((rank - step + coordId) % numInstances, bufsend, query);
+                tuples.clear();
+                return;
+            }
+            if(rank + step < numInstances)
+            {
+                shared_ptr<SharedBuffer> buf = BufReceive((rank + step + coordId) % numInstances, query);
+                if(buf->getSize() % sizeof(uint64_t) != 0 || buf->getSize() < tuples.size() * tupleWords * sizeof(uint64_t))
+                {
+                    throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "mismatched summary sizes across instances";
+                }
+                uint64_t const* in        = (uint64_t const*) buf->getConstData();
+                uint64_t const* const end = in + buf->getSize() / sizeof(uint64_t);
+                for(size_t att = 0; att<tuples.size(); ++att)
+                {
+                    SummaryTuple other;
+                    other.fromPod(in, end, settings);
+                    tuples[att].merge(other);
+                }
+                if(in != end)
+                {
+                    throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "mismatched summary sizes across instances";
+                }
+            }
+        }
+        reduceSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - reduceStart).count();
+    }
+
+    bool makeFinalSummary(Settings const&settings, ArrayDesc const& schema, shared_ptr<Query>& query)
+    {
+        bool const perAtt = settings.perAttributeflag();
+        bool const perIns = settings.perInstanceflag();
+        if(settings.traceflag())
+        {
+            //every instance keeps its own trace rows
+            return true;
+        }
+        if(settings.transferflag() || settings.sweepflag())
+        {
+            //and its own link or sweep rows
+            return true;
+        }
+        for(size_t att = 0; att<summaryData.size(); ++att)
+        {
+            summaryData[att].fullScanSeconds = estimateFullScan(summaryData[att].wallSeconds);
+        }
+        if(perAtt==false && perIns==false)
+        {
+            collapseAttributes();
+            reduceToCoordinator(summaryData, query, settings);
+        }
+        else if(perAtt && !perIns)
+        {
+            reduceToCoordinator(summaryData, query, settings);
+        }
+        else if (perIns && !perAtt)
+        {
+            collapseAttributes();
+        }
+        else
+        {
+            //the matrix: every instance keeps its own row with its total over attributes at the
+            //end, and the coordinator adds a row of totals over instances under them
+            summaryData.push_back(totalOverAttributes());
+            marginalData = summaryData;
+            reduceToCoordinator(marginalData, query, settings);
+        }
+        return true;
+    }
+    static void writeCell(shared_ptr<ChunkIterator> const& ociter, Coordinates const& position, Value const& buf)
+    {
+        ociter->setPosition(position);
+        ociter->writeItem(buf);
+    }
+
+    static void openChunks(shared_ptr<Array> const& outputArray,
+                           Coordinates const& chunkPosition,
+                           shared_ptr<Query>& query,
+                           vector<shared_ptr<ChunkIterator> >& ociters)
+    {
+        for(size_t oatt = 0; oatt<ociters.size(); ++oatt)
+        {
+            if(ociters[oatt])
+            {
+                ociters[oatt]->flush();
+            }
+            ociters[oatt] = outputArray->getIterator(oatt)->newChunk(chunkPosition).getIterator(query, oatt == 0 ?
+                    ChunkIterator::SEQUENTIAL_WRITE :
+                    ChunkIterator::NO_EMPTY_CHECK | ChunkIterator::SEQUENTIAL_WRITE);
+        }
+    }
+
+    shared_ptr<Array> traceToArray(ArrayDesc const& schema, shared_ptr<Query>& query)
+    {
+        shared_ptr<Array> outputArray(new MemArray(schema, query));
+        if (traces.size() == 0)
+        {
+            return outputArray;
+        }
+        std::sort(traces.begin(), traces.end());
+        vector<shared_ptr<ChunkIterator> > ociters(schema.getAttributes(true).size());
+        Coordinates position(3,0);
+        Coordinates chunkPosition(3,-1);
+        position[0]=myInstanceId;
+        Value buf;
+        for(size_t i=0; i<traces.size(); ++i)
+        {
+            ChunkTrace const& t = traces[i];
+            position[2] = (position[1] == (Coordinate) t.att && i>0) ? position[2] + 1 : 0;
+            position[1] = t.att;
+            Coordinates const thisChunk = { position[0], position[1], (position[2] / Settings::TRACE_CHUNK_SIZE) * Settings::TRACE_CHUNK_SIZE };
+            if(thisChunk != chunkPosition)
+            {
+                chunkPosition = thisChunk;
+                openChunks(outputArray, chunkPosition, query, ociters);
+            }
+            size_t oatt = 0;
+
+            buf.setString(summaryData[t.att].attName);
+            writeCell(ociters[oatt++], position, buf);
+
+            for(size_t d = 0; d<t.position.size(); ++d)
+            {
+                buf.reset<int64_t>(t.position[d]);
+                writeCell(ociters[oatt++], position, buf);
+            }
+
+            buf.reset<uint64_t>(t.bytes);
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.reset<uint64_t>(t.cells);
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.reset<int64_t>(startNanos + (int64_t) (t.start * 1.0e9));
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.reset<int64_t>((int64_t) (t.duration * 1.0e9));
+            writeCell(ociters[oatt++], position, buf);
+        }
+        for(size_t oatt = 0; oatt<ociters.size(); ++oatt)
+        {
+            ociters[oatt]->flush();
+        }
+        return outputArray;
+    }
+
+    shared_ptr<Array> linksToArray(ArrayDesc const& schema, shared_ptr<Query>& query)
+    {
+        shared_ptr<Array> outputArray(new MemArray(schema, query));
+        vector<shared_ptr<ChunkIterator> > ociters(schema.getAttributes(true).size());
+        Coordinates position(2,0);
+        position[0]=myInstanceId;
+        openChunks(outputArray, position, query, ociters);
+        Value buf;
+        for(size_t peer=0; peer<links.size(); ++peer)
+        {
+            LinkStats const& l = links[peer];
+            if(!l.used())
+            {
+                continue;
+            }
+            position[1] = peer;
+            double const linkSeconds = l.end - l.start;
+            size_t oatt = 0;
+
+            buf.reset<uint64_t>(l.sentBytes);
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.reset<uint64_t>(l.sentMessages);
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.setDouble(l.sendSeconds);
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.reset<uint64_t>(l.receivedBytes);
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.reset<uint64_t>(l.receivedMessages);
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.setDouble(l.receiveSeconds);
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.setDouble(linkSeconds);
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.setDouble(linkSeconds > 0 ? l.sentBytes / linkSeconds : 0);
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.setDouble(linkSeconds > 0 ? l.receivedBytes / linkSeconds : 0);
+            writeCell(ociters[oatt++], position, buf);
+        }
+        for(size_t oatt = 0; oatt<ociters.size(); ++oatt)
+        {
+            ociters[oatt]->flush();
+        }
+        return outputArray;
+    }
+
+    /*
+     * Efficiency is throughput per worker relative to that of the first level, which is one
+     * thread when the sweep starts at 1.
+     */
+    shared_ptr<Array> sweepToArray(ArrayDesc const& schema, shared_ptr<Query>& query)
+    {
+        shared_ptr<Array> outputArray(new MemArray(schema, query));
+        if(sweep.empty())
+        {
+            return outputArray;
+        }
+        vector<shared_ptr<ChunkIterator> > ociters(schema.getAttributes(true).size());
+        Coordinates position(2,0);
+        position[0]=myInstanceId;
+        openChunks(outputArray, position, query, ociters);
+        Value buf;
+        double baseRate = 0;
+        for(size_t l=0; l<sweep.size(); ++l)
+        {
+            SweepLevel const& level = sweep[l];
+            SummaryTuple const& t = level.total;
+            double const rate = t.wallSeconds > 0 ? t.readBytes / t.wallSeconds : 0;
+            if(l == 0)
+            {
+                baseRate = rate / level.workers;
+            }
+            position[1] = level.threads;
+            size_t oatt = 0;
+
+            buf.reset<uint64_t>(level.workers);
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.reset<uint64_t>(t.readBytes);
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.setDouble(t.wallSeconds);
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.setDouble(rate);
+            writeCell(ociters[oatt++], position, buf);
+
+            if(baseRate > 0)
+            {
+                buf.setDouble(rate / level.workers / baseRate);
+            }
+            else
+            {
+                buf.setNull();
+            }
+            writeCell(ociters[oatt++], position, buf);
+
+            if(t.chunkLatency.count() > 0)
+            {
+                buf.setDouble(t.chunkLatency.quantileSeconds(0.99));
+            }
+            else
+            {
+                buf.setNull();
+            }
+            writeCell(ociters[oatt++], position, buf);
+        }
+        for(size_t oatt = 0; oatt<ociters.size(); ++oatt)
+        {
+            ociters[oatt]->flush();
+        }
+        return outputArray;
+    }
+
+    /*
+     * Mean, sample standard deviation, min and max of values, in four cells. The deviation is
+     * null for fewer than two values, everything is for none.
+     */
+    static void writeStats(vector<shared_ptr<ChunkIterator> > const& ociters,
+                           size_t& oatt,
+                           Coordinates const& position,
+                           vector<double> const& values)
+    {
+        size_t const n = values.size();
+        double sum = 0;
+        double minValue = std::numeric_limits<double>::max();
+        double maxValue = -std::numeric_limits<double>::max();
+        for(size_t i = 0; i<n; ++i)
+        {
+            sum += values[i];
+            minValue = std::min(minValue, values[i]);
+            maxValue = std::max(maxValue, values[i]);
+        }
+        double const mean = n > 0 ? sum / n : 0;
+        double squares = 0;
+        for(size_t i = 0; i<n; ++i)
+        {
+            squares += (values[i] - mean) * (values[i] - mean);
+        }
+        Value buf;
+        double const stats[] = { mean, n > 1 ? sqrt(squares / (n - 1)) : 0, minValue, maxValue };
+        for(size_t k = 0; k<sizeof(stats)/sizeof(stats[0]); ++k)
+        {
+            if(n == 0 || (k == 1 && n < 2))
+            {
+                buf.setNull();
+            }
+            else
+            {
+                buf.setDouble(stats[k]);
+            }
+            writeCell(ociters[oatt++], position, buf);
+        }
+    }
+
+    /*
+     * The counters and instructions per cycle, null where some contributing thread couldn't open
+     * a counter.
+     */
+    static void writeCounters(vector<shared_ptr<ChunkIterator> > const& ociters,
+                              size_t& oatt,
+                              Coordinates const& position,
+                              vector<uint64_t> const& counters,
+                              uint64_t const missing)
+    {
+        Value buf;
+        for(size_t c = 0; c<NUM_COUNTERS; ++c)
+        {
+            if(missing & (1 << c))
+            {
+                buf.setNull();
+            }
+            else
+            {
+                buf.reset<uint64_t>(counters[c]);
+            }
+            writeCell(ociters[oatt++], position, buf);
+        }
+        uint64_t const ipcInputs = (1 << COUNTER_CYCLES) | (1 << COUNTER_INSTRUCTIONS);
+        if((missing & ipcInputs) || counters[COUNTER_CYCLES] == 0)
+        {
+            buf.setNull();
+        }
+        else
+        {
+            buf.setDouble(((double)counters[COUNTER_INSTRUCTIONS])/counters[COUNTER_CYCLES]);
+        }
+        writeCell(ociters[oatt++], position, buf);
+    }
+
+    /*
+     * Write one output cell per tuple along the attid dimension, starting at position. reduced
+     * says whether the tuples came out of the reduction, the only rows that get reduce_seconds.
+     */
+    void writeRows(Settings const& settings,
+                   vector<SummaryTuple> const& tuples,
+                   Coordinates position,
+                   vector<shared_ptr<ChunkIterator> > const& ociters,
+                   bool const reduced) const
+    {
+        Value buf;
+        for(size_t i=0; i<tuples.size(); ++i, position[1]++)
+        {
+            if(tuples.size() > 1 && i < settings.numInputAttributes() && !settings.attributeSelected(i))
+            {
+                continue;
+            }
+            SummaryTuple const& t = tuples[i];
+            LOG4CXX_DEBUG(logger, std::setprecision(4) << "write array read bytes foo4:" << t.readBytes);
+            LOG4CXX_DEBUG(logger, std::setprecision(4) << "write array seconds foo4:"    << t.totalSeconds);
+            size_t oatt = 0;
 
             buf.setString(t.attName);
-            ociters[0]->setPosition(position);
-            ociters[0]->writeItem(buf);
+            writeCell(ociters[oatt++], position, buf);
 
             buf.reset<uint64_t>((uint64_t)t.readBytes);
-            ociters[1]->setPosition(position);
-            ociters[1]->writeItem(buf);
+            writeCell(ociters[oatt++], position, buf);
 
             buf.reset<double>((double)t.totalSeconds);
-            ociters[2]->setPosition(position);
-            ociters[2]->writeItem(buf);
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.setDouble(((double)t.readBytes)/((double)t.totalSeconds));
+            writeCell(ociters[oatt++], position, buf);
+
+            if(settings.accessflag())
+            {
+                buf.reset<uint64_t>(t.cells);
+                writeCell(ociters[oatt++], position, buf);
+
+                buf.setDouble(((double)t.cells)/((double)t.totalSeconds));
+                writeCell(ociters[oatt++], position, buf);
+            }
+
+            buf.setDouble(t.wallSeconds);
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.setDouble(((double)t.readBytes)/t.wallSeconds);
+            writeCell(ociters[oatt++], position, buf);
+
+            buf.reset<uint64_t>(t.chunkLatency.count());
+            writeCell(ociters[oatt++], position, buf);
+
+            double const latencies[] = { t.chunkLatency.minSeconds(),
+                                         t.chunkLatency.quantileSeconds(0.50),
+                                         t.chunkLatency.quantileSeconds(0.90),
+                                         t.chunkLatency.quantileSeconds(0.99),
+                                         t.chunkLatency.maxSeconds() };
+            for(size_t l = 0; l<sizeof(latencies)/sizeof(latencies[0]); ++l)
+            {
+                if(t.chunkLatency.count() == 0)
+                {
+                    buf.setNull();
+                }
+                else
+                {
+                    buf.setDouble(latencies[l]);
+                }
+                writeCell(ociters[oatt++], position, buf);
+            }
+
+            if(!reduced || reduceSeconds < 0)
+            {
+                buf.setNull();
+            }
+            else
+            {
+                buf.setDouble(reduceSeconds);
+            }
+            writeCell(ociters[oatt++], position, buf);
+
+            if(settings.stageTimingflag())
+            {
+                buf.setDouble(t.fetchSeconds);
+                writeCell(ociters[oatt++], position, buf);
+
+                buf.setDouble(t.consumeSeconds);
+                writeCell(ociters[oatt++], position, buf);
+
+                buf.setDouble(t.stallSeconds);
+                writeCell(ociters[oatt++], position, buf);
+            }
+            if(settings.sinkType() == SINK_CHECKSUM)
+            {
+                buf.reset<uint64_t>(t.digest);
+                writeCell(ociters[oatt++], position, buf);
+            }
+            if(settings.sinkStallflag())
+            {
+                buf.setDouble(t.sinkStallSeconds);
+                writeCell(ociters[oatt++], position, buf);
+            }
+            if(settings.batchflag())
+            {
+                buf.reset<uint64_t>(t.batches);
+                writeCell(ociters[oatt++], position, buf);
+
+                buf.setDouble(t.batchSeconds);
+                writeCell(ociters[oatt++], position, buf);
+
+                buf.setDouble(t.wallSeconds > 0 ? t.batchedBytes / t.wallSeconds : 0);
+                writeCell(ociters[oatt++], position, buf);
+            }
+            for(size_t c = 0; c<settings.numCompressors(); ++c)
+            {
+                uint64_t const compressedBytes = c < t.compressedBytes.size() ? t.compressedBytes[c] : 0;
+                double const compressSeconds   = c < t.compressSeconds.size() ? t.compressSeconds[c] : 0;
+                buf.reset<uint64_t>(compressedBytes);
+                writeCell(ociters[oatt++], position, buf);
+
+                buf.setDouble(compressedBytes > 0 ? ((double)t.readBytes)/compressedBytes : 0);
+                writeCell(ociters[oatt++], position, buf);
+
+                buf.setDouble(compressSeconds);
+                writeCell(ociters[oatt++], position, buf);
+
+                buf.setDouble(compressSeconds > 0 ? ((double)t.readBytes)/compressSeconds : 0);
+                writeCell(ociters[oatt++], position, buf);
+            }
+            if(settings.breakdownflag())
+            {
+                double phaseTotal = 0;
+                for(size_t p = 0; p<NUM_PHASES; ++p)
+                {
+                    phaseTotal += t.phaseSeconds[p];
+                }
+                for(size_t p = 0; p<NUM_PHASES; ++p)
+                {
+                    buf.setDouble(t.phaseSeconds[p]);
+                    writeCell(ociters[oatt++], position, buf);
+
+                    buf.setDouble(phaseTotal > 0 ? 100.0 * t.phaseSeconds[p] / phaseTotal : 0);
+                    writeCell(ociters[oatt++], position, buf);
+                }
+                buf.reset<uint64_t>(t.allocations);
+                writeCell(ociters[oatt++], position, buf);
+
+                buf.reset<uint64_t>(t.allocatedBytes);
+                writeCell(ociters[oatt++], position, buf);
+            }
+            if(settings.countersflag())
+            {
+                writeCounters(ociters, oatt, position, t.counters, t.countersMissing);
+            }
+            if(settings.fetchCountersflag())
+            {
+                writeCounters(ociters, oatt, position, t.fetchCounters, t.fetchCountersMissing);
+            }
+            for(size_t n = 0; n<settings.numNumaNodes(); ++n)
+            {
+                buf.reset<uint64_t>(n < t.nodeBytes.size() ? t.nodeBytes[n] : 0);
+                writeCell(ociters[oatt++], position, buf);
+            }
+            if(settings.selectionflag())
+            {
+                if(t.fullScanSeconds < 0)
+                {
+                    buf.setNull();
+                }
+                else
+                {
+                    buf.setDouble(t.fullScanSeconds);
+                }
+                writeCell(ociters[oatt++], position, buf);
+            }
+            if(settings.directflag())
+            {
+                //the storage files hold every attribute, so only totals over attributes have these
+                if(t.directSeconds < 0)
+                {
+                    buf.setNull();
+                    writeCell(ociters[oatt++], position, buf);
+                    writeCell(ociters[oatt++], position, buf);
+                    writeCell(ociters[oatt++], position, buf);
+                }
+                else
+                {
+                    buf.reset<uint64_t>(t.directBytes);
+                    writeCell(ociters[oatt++], position, buf);
+
+                    buf.setDouble(t.directSeconds);
+                    writeCell(ociters[oatt++], position, buf);
+
+                    buf.setDouble(t.directSeconds > 0 ? t.directBytes / t.directSeconds : 0);
+                    writeCell(ociters[oatt++], position, buf);
+                }
+            }
+            if(settings.fileflag())
+            {
+                //the file is written by all of an instance's workers, so only totals over
+                //attributes have these; the rate includes making the file durable
+                if(t.fileWriteSeconds < 0)
+                {
+                    buf.setNull();
+                    for(size_t k = 0; k<4; ++k)
+                    {
+                        writeCell(ociters[oatt++], position, buf);
+                    }
+                }
+                else
+                {
+                    buf.reset<uint64_t>(t.fileBytes);
+                    writeCell(ociters[oatt++], position, buf);
+
+                    buf.setDouble(t.fileWriteSeconds);
+                    writeCell(ociters[oatt++], position, buf);
+
+                    buf.setDouble(t.fileFsyncSeconds);
+                    writeCell(ociters[oatt++], position, buf);
+
+                    double const fileSeconds = t.fileWriteSeconds + t.fileFsyncSeconds;
+                    buf.setDouble(fileSeconds > 0 ? t.fileBytes / fileSeconds : 0);
+                    writeCell(ociters[oatt++], position, buf);
+                }
+            }
+            if(settings.consumeRateflag())
+            {
+                //one consumer per instance, so again only totals over attributes
+                if(t.consumerSeconds < 0)
+                {
+                    buf.setNull();
+                    for(size_t k = 0; k<3; ++k)
+                    {
+                        writeCell(ociters[oatt++], position, buf);
+                    }
+                }
+                else
+                {
+                    buf.setDouble(t.consumerStarvedSeconds);
+                    writeCell(ociters[oatt++], position, buf);
+
+                    buf.setDouble(t.consumerSeconds);
+                    writeCell(ociters[oatt++], position, buf);
+
+                    buf.setDouble(t.consumerSeconds > 0 ? t.consumerBytes / t.consumerSeconds : 0);
+                    writeCell(ociters[oatt++], position, buf);
+                }
+            }
+            if(settings.repeatflag())
+            {
+                buf.reset<uint64_t>(t.iterationWall.size());
+                writeCell(ociters[oatt++], position, buf);
+
+                vector<double> bytesPerSecond(t.iterationWall.size(), 0);
+                for(size_t i = 0; i<t.iterationWall.size(); ++i)
+                {
+                    if(t.iterationWall[i] > 0 && i < t.iterationBytes.size())
+                    {
+                        bytesPerSecond[i] = t.iterationBytes[i] / t.iterationWall[i];
+                    }
+                }
+                writeStats(ociters, oatt, position, t.iterationWall);
+                writeStats(ociters, oatt, position, bytesPerSecond);
+            }
+        }
+    }
 
-            buf.setDouble(((double)t.readBytes)/((double)t.totalSeconds/1000.0));
-            ociters[3]->setPosition(position);
-            ociters[3]->writeItem(buf);
-            position[1]++;
+    shared_ptr<Array> toArray(Settings const& settings,ArrayDesc const& schema, shared_ptr<Query>& query)
+    {
+        if(settings.traceflag())
+        {
+            return traceToArray(schema, query);
         }
-        for(size_t oatt = 0; oatt<Settings::NUM_OUTPUT_ATTRIBUTES; ++oatt)
+        if(settings.transferflag())
         {
-            ociters[oatt]->flush();
+            return linksToArray(schema, query);
+        }
+        if(settings.sweepflag())
+        {
+            return sweepToArray(schema, query);
+        }
+        shared_ptr<Array> outputArray(new MemArray(schema, query));
+        size_t const numOutputAtts = schema.getAttributes(true).size();
+        vector<shared_ptr<ChunkIterator> > ociters(numOutputAtts);
+        Coordinates position(2,0);
+        if(summaryData.size() > 0)
+        {
+            position[0]=myInstanceId;
+            openChunks(outputArray, position, query, ociters);
+            //in the matrix these are the instance's own rows, not reduced ones
+            writeRows(settings, summaryData, position, ociters, marginalData.empty());
+        }
+        if(marginalData.size() > 0)
+        {
+            position[0]=query->getInstancesCount();
+            openChunks(outputArray, position, query, ociters);
+            writeRows(settings, marginalData, position, ociters, true);
+        }
+        for(size_t oatt = 0; oatt<numOutputAtts; ++oatt)
+        {
+            if(ociters[oatt])
+            {
+                ociters[oatt]->flush();
+            }
         }
         return outputArray;
     }
@@ -0,0 +1,829 @@
+/*
+**
+* BEGIN_COPYRIGHT
+*
+* Copyright (C) 2008-2016 SciDB, Inc.
+* All Rights Reserved.
+*
+* Pull is a plugin for SciDB, an Open Source Array DBMS maintained
+* by Paradigm4. See http://www.paradigm4.com/
+*
+* Pull is free software: you can redistribute it and/or modify
+* it under the terms of the AFFERO GNU General Public License as published by
+* the Free Software Foundation.
+*
+* summarize is distributed "AS-IS" AND WITHOUT ANY WARRANTY OF ANY KIND,
+* INCLUDING ANY IMPLIED WARRANTY OF MERCHANTABILITY,
+* NON-INFRINGEMENT, OR FITNESS FOR A PARTICULAR PURPOSE. See
+* the AFFERO GNU General Public License for the complete license terms.
+*
+* You should have received a copy of the AFFERO GNU General Public License
+* along with summarize.  If not, see <http://www.gnu.org/licenses/agpl-3.0.html>
+*
+* END_COPYRIGHT
+*/
+
+#ifndef PULL_SINKS
+#define PULL_SINKS
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <query/Operator.h>
+#include <array/Array.h>
+#include <array/RLE.h>
+#include <array/Tile.h>
+
+#include <MurmurHash/MurmurHash3.h>
+
+#include "PullSettings.h"
+#include "MemChunkBuilder.h"
+#include "ThreadArena.h"
+#include "ShmRing.h"
+#include "TokenBucket.h"
+
+namespace scidb
+{
+namespace pull
+{
+
+/*
+ * A reusable, aligned staging buffer that only ever grows. Unlike reserve()-ing a std::vector
+ * and writing through begin(), the memory it hands out is really ours to write. Buffers of a
+ * worker take their memory from its ThreadArena; others use the heap.
+ */
+class AlignedBuffer
+{
+private:
+    static const size_t ALIGNMENT = 4096;
+
+    char*        _data;
+    size_t       _capacity;
+    ThreadArena* _arena;
+
+    AlignedBuffer(AlignedBuffer const&);
+    AlignedBuffer& operator=(AlignedBuffer const&);
+
+public:
+    explicit AlignedBuffer(ThreadArena* arena = NULL):
+        _data(NULL),
+        _capacity(0),
+        _arena(arena)
+    {}
+
+    ~AlignedBuffer()
+    {
+        if(_arena)
+        {
+            _arena->release(_data, _capacity);
+        }
+        else
+        {
+            ::free(_data);
+        }
+    }
+
+    /*
+     * Return a buffer of at least size bytes. Only the first keep bytes survive growth. Growing
+     * to keep data at least doubles the capacity, so appending chunk by chunk stays linear.
+     */
+    char* reserve(size_t const size, size_t const keep = 0)
+    {
+        if(size > _capacity)
+        {
+            size_t newCapacity = keep > 0 ? std::max(size, 2 * _capacity) : size;
+            newCapacity = ((newCapacity + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+            void* ptr = NULL;
+            if(_arena)
+            {
+                ptr = _arena->allocate(newCapacity);
+            }
+            else if(posix_memalign(&ptr, ALIGNMENT, newCapacity) != 0)
+            {
+                throw SYSTEM_EXCEPTION(SCIDB_SE_NO_MEMORY, SCIDB_LE_MEMORY_ALLOCATION_ERROR) << "staging buffer";
+            }
+            if(keep > 0)
+            {
+                memcpy(ptr, _data, keep);
+            }
+            if(_arena)
+            {
+                _arena->release(_data, _capacity);
+            }
+            else
+            {
+                ::free(_data);
+            }
+            _data = (char*) ptr;
+            _capacity = newCapacity;
+        }
+        return _data;
+    }
+
+    char* data() const
+    {
+        return _data;
+    }
+};
+
+/*
+ * What happens to a chunk once it has been read and pinned. Every consumer owns its own sink, so
+ * implementations need not be thread-safe.
+ */
+class ChunkSink
+{
+public:
+    virtual ~ChunkSink()
+    {}
+
+    /*
+     * Consume the payload of a pinned chunk. Returns the chunk's digest, or 0 for sinks that
+     * don't compute one.
+     */
+    virtual uint64_t consume(ConstChunk const& chunk) = 0;
+
+    /*
+     * Seconds consume() spent waiting on whatever is downstream since the last call.
+     */
+    virtual double takeStallSeconds()
+    {
+        return 0;
+    }
+
+    /*
+     * Called once the worker has no more chunks, to hand over anything still held back.
+     */
+    virtual void finish()
+    {}
+};
+
+/*
+ * Pin only: measures the read alone.
+ */
+class NoneSink : public ChunkSink
+{
+public:
+    virtual uint64_t consume(ConstChunk const& chunk)
+    {
+        return 0;
+    }
+};
+
+/*
+ * Copy the raw payload into a staging buffer.
+ */
+class MemcpySink : public ChunkSink
+{
+private:
+    AlignedBuffer _staging;
+
+public:
+    explicit MemcpySink(ThreadArena& arena):
+        _staging(&arena)
+    {}
+
+    virtual uint64_t consume(ConstChunk const& chunk)
+    {
+        size_t const size = chunk.getSize();
+        memcpy(_staging.reserve(size), chunk.getConstData(), size);
+        return 0;
+    }
+};
+
+/*
+ * Hash the whole payload with a four-lane variant of the MurmurHash3 x64 body: consecutive 8-byte
+ * words go to independent lanes, so the multiply/rotate chains don't wait on each other and the
+ * hash keeps up with memory. The lanes are folded together with the vendored fmix. This is not
+ * bit-compatible with MurmurHash3_x64_128; it only has to agree with itself.
+ */
+class ChecksumSink : public ChunkSink
+{
+private:
+    static const size_t LANES = 4;
+
+    static uint64_t rotl64(uint64_t x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    static uint64_t mixWord(uint64_t h, uint64_t k)
+    {
+        k *= BIG_CONSTANT(0x87c37b91114253d5);
+        k  = rotl64(k, 31);
+        k *= BIG_CONSTANT(0x4cf5ad432745937f);
+        h ^= k;
+        h  = rotl64(h, 27);
+        return h * 5 + 0x52dce729;
+    }
+
+public:
+    static uint64_t hash(void const* data, size_t const size, uint64_t const seed)
+    {
+        char const* bytes = (char const*) data;
+        uint64_t h[LANES];
+        for(size_t l = 0; l < LANES; ++l)
+        {
+            h[l] = fmix(seed + l);
+        }
+        size_t const numWords = size / sizeof(uint64_t);
+        size_t w = 0;
+        for(; w + LANES <= numWords; w += LANES)
+        {
+            uint64_t words[LANES];
+            memcpy(words, bytes + w * sizeof(uint64_t), sizeof(words));
+            for(size_t l = 0; l < LANES; ++l)
+            {
+                h[l] = mixWord(h[l], words[l]);
+            }
+        }
+        for(size_t l = 0; w < numWords; ++w, ++l)
+        {
+            uint64_t word;
+            memcpy(&word, bytes + w * sizeof(uint64_t), sizeof(word));
+            h[l] = mixWord(h[l], word);
+        }
+        uint64_t tail = 0;
+        if(size > numWords * sizeof(uint64_t))
+        {
+            memcpy(&tail, bytes + numWords * sizeof(uint64_t), size - numWords * sizeof(uint64_t));
+        }
+        uint64_t result = fmix((uint64_t) size ^ tail);
+        for(size_t l = 0; l < LANES; ++l)
+        {
+            result = fmix(result ^ h[l]);
+        }
+        return result;
+    }
+
+    /*
+     * The chunk's position seeds its hash, so two runs only agree if the same payloads were read
+     * at the same places. Chunk digests are combined by addition, which doesn't care about the
+     * order threads and instances read them in.
+     */
+    virtual uint64_t consume(ConstChunk const& chunk)
+    {
+        Coordinates const& pos = chunk.getFirstPosition(false);
+        uint64_t const seed = hash(&pos[0], pos.size() * sizeof(Coordinate), 0);
+        return hash(chunk.getConstData(), chunk.getSize(), seed);
+    }
+};
+
+/*
+ * Expand the chunk into a dense buffer: one value per cell for fixed-size attributes, the values
+ * back to back for variable-size ones, and the cell positions for the empty tag.
+ */
+class DecodeSink : public ChunkSink
+{
+private:
+    AlignedBuffer _dense;
+
+    void decodeEmptyBitmap(ConstChunk const& chunk)
+    {
+        ConstRLEEmptyBitmap bitmap((char const*) chunk.getConstData());
+        position_t* out = (position_t*) _dense.reserve(bitmap.count() * sizeof(position_t));
+        for(size_t s = 0; s < bitmap.nSegments(); ++s)
+        {
+            ConstRLEEmptyBitmap::Segment const& seg = bitmap.getSegment(s);
+            for(position_t p = 0; p < seg._length; ++p)
+            {
+                *out++ = seg._pPosition + p;
+            }
+        }
+    }
+
+    void decodeFixed(ConstRLEPayload const& payload, size_t const elemSize)
+    {
+        char* out = _dense.reserve(payload.count() * elemSize);
+        ConstRLEPayload::iterator it(&payload);
+        while(!it.end())
+        {
+            size_t const length = it.getSegLength();
+            if(it.isNull())
+            {
+                memset(out, 0, length * elemSize);
+            }
+            else if(it.isSame())
+            {
+                size_t valSize;
+                char const* value = it.getRawValue(valSize);
+                for(size_t c = 0; c < length; ++c)
+                {
+                    memcpy(out + c * elemSize, value, elemSize);
+                }
+            }
+            else
+            {
+                memcpy(out, it.getFixedValues(), length * elemSize);
+            }
+            out += length * elemSize;
+            it.toNextSegment();
+        }
+    }
+
+    void decodeVariable(ConstRLEPayload const& payload)
+    {
+        size_t used = 0;
+        ConstRLEPayload::iterator it(&payload);
+        Value item;
+        while(!it.end())
+        {
+            it.getItem(item);
+            char* out = _dense.reserve(used + item.size(), used);
+            memcpy(out + used, item.data(), item.size());
+            used += item.size();
+            ++it;
+        }
+    }
+
+public:
+    explicit DecodeSink(ThreadArena& arena):
+        _dense(&arena)
+    {}
+
+    virtual uint64_t consume(ConstChunk const& chunk)
+    {
+        AttributeDesc const& attr = chunk.getAttributeDesc();
+        if(attr.isEmptyIndicator())
+        {
+            decodeEmptyBitmap(chunk);
+            return 0;
+        }
+        ConstRLEPayload payload((char const*) chunk.getConstData());
+        if(attr.getSize() == 0 || attr.getType() == TID_BOOL)
+        {
+            decodeVariable(payload);
+        }
+        else
+        {
+            decodeFixed(payload, attr.getSize());
+        }
+        return 0;
+    }
+};
+
+/*
+ * access=cell: read every cell through the chunk iterator, the way most operators do. The first
+ * word of each value is folded into a member so the reads can't be optimized away.
+ */
+class CellSink : public ChunkSink
+{
+private:
+    uint64_t _fold;
+
+public:
+    CellSink():
+        _fold(0)
+    {}
+
+    virtual uint64_t consume(ConstChunk const& chunk)
+    {
+        shared_ptr<ConstChunkIterator> iciter = chunk.getConstIterator(ConstChunkIterator::IGNORE_OVERLAPS | ConstChunkIterator::IGNORE_EMPTY_CELLS);
+        uint64_t fold = _fold;
+        for(; !iciter->end(); ++(*iciter))
+        {
+            Value const& value = iciter->getItem();
+            uint64_t word = 0;
+            if(!value.isNull() && value.size() > 0)
+            {
+                memcpy(&word, value.data(), std::min<size_t>(value.size(), sizeof(word)));
+            }
+            fold = fold * 31 + word;
+        }
+        _fold = fold;
+        return 0;
+    }
+};
+
+/*
+ * access=tile: read the chunk a tile of up to TILE_SIZE values at a time through
+ * ConstChunkIterator::getData, which returns the logical position of the next unread cell, or a
+ * negative one at the end of the chunk.
+ */
+class TileSink : public ChunkSink
+{
+private:
+    static const size_t TILE_SIZE = 8192;
+
+    shared_ptr<BaseTile> _tile;
+    uint64_t             _values;
+
+public:
+    TileSink():
+        _values(0)
+    {}
+
+    virtual uint64_t consume(ConstChunk const& chunk)
+    {
+        shared_ptr<ConstChunkIterator> iciter = chunk.getConstIterator(ConstChunkIterator::IGNORE_OVERLAPS |
+                                                                       ConstChunkIterator::IGNORE_EMPTY_CELLS |
+                                                                       ConstChunkIterator::INTENDED_TILE_MODE);
+        if(iciter->end())
+        {
+            return 0;
+        }
+        position_t next = iciter->getLogicalPosition();
+        while(next >= 0)
+        {
+            next = iciter->getData(next, TILE_SIZE, _tile);
+            if(!_tile || _tile->size() == 0)
+            {
+                break;
+            }
+            _values += _tile->size();
+        }
+        return 0;
+    }
+};
+
+/*
+ * batch_bytes=N: append every payload, behind its size as 8 bytes, to a MemChunkBuilder per
+ * attribute, and cut a batch whenever one holds N bytes or more. A batch is a one-cell chunk
+ * whose single value is the run of framed payloads, which is how a trainer would want many small
+ * chunks handed over. The time spent copying and cutting is the batching overhead.
+ */
+class BatchSink : public ChunkSink
+{
+private:
+    size_t const                              _batchBytes;
+    ThreadSummary&                            _threadSummary;
+    vector<std::unique_ptr<MemChunkBuilder> > _builders;    //by attribute, made on first use
+
+    size_t batchSize(AttributeID const att) const
+    {
+        return _builders[att]->getTotalSize() - MemChunkBuilder::chunkDataOffset();
+    }
+
+    void cutBatch(AttributeID const att)
+    {
+        size_t const size = batchSize(att);
+        //seals the payload header; this is where a consumer would take the batch
+        _builders[att]->getChunk();
+        _threadSummary.addBatchData(att, 1, size, 0);
+        _builders[att]->reset();
+    }
+
+public:
+    BatchSink(size_t const batchBytes, ThreadSummary& threadSummary):
+        _batchBytes(batchBytes),
+        _threadSummary(threadSummary)
+    {}
+
+    virtual uint64_t consume(ConstChunk const& chunk)
+    {
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+        AttributeID const att = chunk.getAttributeDesc().getId();
+        if(_builders.size() <= att)
+        {
+            _builders.resize(att + 1);
+        }
+        if(!_builders[att])
+        {
+            _builders[att].reset(new MemChunkBuilder(MemChunkBuilder::chunkDataOffset() + _batchBytes));
+        }
+        uint64_t const size = chunk.getSize();
+        _builders[att]->addData((char const*) &size, sizeof(size));
+        _builders[att]->addData((char const*) chunk.getConstData(), size);
+        if(batchSize(att) >= _batchBytes)
+        {
+            cutBatch(att);
+        }
+        _threadSummary.addBatchData(att, 0, 0, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        return 0;
+    }
+
+    virtual void finish()
+    {
+        for(AttributeID att = 0; att<_builders.size(); ++att)
+        {
+            if(_builders[att] && batchSize(att) > 0)
+            {
+                std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+                cutBatch(att);
+                _threadSummary.addBatchData(att, 0, 0, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            }
+        }
+    }
+};
+
+/*
+ * Where sinks that hand chunks out of the process send them. One target is shared by every
+ * worker of an instance, so implementations must be thread-safe.
+ */
+class SinkTarget
+{
+public:
+    virtual ~SinkTarget()
+    {}
+
+    /*
+     * Take one chunk's payload. Returns the seconds spent waiting on whatever is downstream.
+     */
+    virtual double write(AttributeID const att, Coordinates const& position, void const* payload, uint64_t const payloadSize) = 0;
+};
+
+/*
+ * The producer end of a ShmRing, shared by the workers of one instance. It creates the segment
+ * and waits for a consumer to attach, and on destruction marks the ring closed and unlinks the
+ * name; a consumer that is attached keeps its mapping and drains what is left.
+ */
+class ShmRingProducer : public SinkTarget
+{
+private:
+    static const uint64_t RING_BYTES = 256 * 1024 * 1024;
+    static const int      CONSUMER_TIMEOUT_SECONDS = 60;
+
+    string         _name;
+    ShmRingHeader* _header;
+    char*          _ring;
+    std::mutex     _mutex;
+
+    ShmRingProducer(ShmRingProducer const&);
+    ShmRingProducer& operator=(ShmRingProducer const&);
+
+    /*
+     * Mark a ring left under our name as retired, so a consumer attached to it moves on to ours.
+     */
+    void retireLeftover()
+    {
+        int const fd = shm_open(_name.c_str(), O_RDWR, 0);
+        if(fd < 0)
+        {
+            return;
+        }
+        struct stat st;
+        if(fstat(fd, &st) == 0 && st.st_size >= (off_t) SHM_HEADER_SIZE)
+        {
+            void* const segment = mmap(NULL, SHM_HEADER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if(segment != MAP_FAILED)
+            {
+                ((ShmRingHeader*) segment)->retired.store(1, std::memory_order_release);
+                munmap(segment, SHM_HEADER_SIZE);
+            }
+        }
+        close(fd);
+        LOG4CXX_WARN(logger, "pull: replacing shared-memory ring " << _name << " left over from an earlier query");
+    }
+
+    /*
+     * Block until a consumer has attached, so the workers don't start timing against an
+     * empty room. None within CONSUMER_TIMEOUT_SECONDS fails the query.
+     */
+    bool waitForConsumer()
+    {
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+        while(_header->consumers.load(std::memory_order_acquire) == 0)
+        {
+            if(std::chrono::steady_clock::now() - start > std::chrono::seconds((int) CONSUMER_TIMEOUT_SECONDS))
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return true;
+    }
+
+    /*
+     * Block until the ring has room for bytes more. A consumer that makes no progress for
+     * CONSUMER_TIMEOUT_SECONDS fails the query rather than hanging it.
+     */
+    void waitForRoom(uint64_t const head, uint64_t const bytes)
+    {
+        uint64_t lastTail = _header->tail.load(std::memory_order_acquire);
+        std::chrono::steady_clock::time_point lastProgress = std::chrono::steady_clock::now();
+        size_t spins = 0;
+        while(_header->capacity - (head - _header->tail.load(std::memory_order_acquire)) < bytes)
+        {
+            if(++spins < 1000)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            uint64_t const tail = _header->tail.load(std::memory_order_acquire);
+            if(tail != lastTail)
+            {
+                lastTail = tail;
+                lastProgress = std::chrono::steady_clock::now();
+            }
+            else if(std::chrono::steady_clock::now() - lastProgress > std::chrono::seconds((int) CONSUMER_TIMEOUT_SECONDS))
+            {
+                ostringstream error;
+                error<<"no consumer drained shared-memory ring "<<_name;
+                throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+            }
+        }
+    }
+
+public:
+    explicit ShmRingProducer(string const& name):
+        _name(name),
+        _header(NULL),
+        _ring(NULL)
+    {
+        size_t const segmentSize = SHM_HEADER_SIZE + RING_BYTES;
+        retireLeftover();
+        shm_unlink(_name.c_str());
+        int const fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if(fd < 0 || ftruncate(fd, segmentSize) != 0)
+        {
+            if(fd >= 0)
+            {
+                close(fd);
+                shm_unlink(_name.c_str());
+            }
+            ostringstream error;
+            error<<"can't create shared-memory ring "<<_name;
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+        }
+        void* const segment = mmap(NULL, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if(segment == MAP_FAILED)
+        {
+            shm_unlink(_name.c_str());
+            throw SYSTEM_EXCEPTION(SCIDB_SE_NO_MEMORY, SCIDB_LE_MEMORY_ALLOCATION_ERROR) << "shared-memory ring";
+        }
+        _header = new (segment) ShmRingHeader();
+        _ring   = (char*) segment + SHM_HEADER_SIZE;
+        _header->capacity = RING_BYTES;
+        _header->closed.store(0);
+        _header->consumers.store(0);
+        _header->retired.store(0);
+        _header->head.store(0);
+        _header->tail.store(0);
+        _header->magic.store(SHM_MAGIC, std::memory_order_release);
+        if(!waitForConsumer())
+        {
+            munmap(_header, segmentSize);
+            shm_unlink(_name.c_str());
+            ostringstream error;
+            error<<"no consumer attached to shared-memory ring "<<_name;
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << error.str().c_str();
+        }
+    }
+
+    ~ShmRingProducer()
+    {
+        _header->closed.store(1, std::memory_order_release);
+        munmap(_header, SHM_HEADER_SIZE + RING_BYTES);
+        shm_unlink(_name.c_str());
+    }
+
+    string const& name() const
+    {
+        return _name;
+    }
+
+    /*
+     * Publish one chunk, waiting for the consumer to make room.
+     */
+    virtual double write(AttributeID const att, Coordinates const& position, void const* payload, uint64_t const payloadSize)
+    {
+        uint64_t const recordSize = shmRecordSize(position.size(), payloadSize);
+        if(recordSize > RING_BYTES / 2)
+        {
+            //then a record and the skip in front of it always fit in an empty ring
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "chunk is larger than half the shared-memory ring";
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        uint64_t head = _header->head.load(std::memory_order_relaxed);
+        uint64_t const offset = head % RING_BYTES;
+        uint64_t const skip = RING_BYTES - offset < recordSize ? RING_BYTES - offset : 0;
+        std::chrono::steady_clock::time_point const waitStart = std::chrono::steady_clock::now();
+        waitForRoom(head, skip + recordSize);
+        double const stall = std::chrono::duration<double>(std::chrono::steady_clock::now() - waitStart).count();
+        if(skip >= sizeof(ShmRecord))
+        {
+            ShmRecord wrap = { SHM_WRAP, 0, 0 };
+            memcpy(_ring + offset, &wrap, sizeof(wrap));
+        }
+        head += skip;
+        char* out = _ring + head % RING_BYTES;
+        ShmRecord const record = { att, (uint32_t) position.size(), payloadSize };
+        memcpy(out, &record, sizeof(record));
+        memcpy(out + sizeof(record), &position[0], position.size() * sizeof(int64_t));
+        memcpy(out + sizeof(record) + position.size() * sizeof(int64_t), payload, payloadSize);
+        _header->head.store(head + recordSize, std::memory_order_release);
+        return stall;
+    }
+};
+
+/*
+ * sink=shm and sink=file: pass the raw payload, with its attribute and position, to the
+ * instance's SinkTarget, and keep count of how long the target made us wait.
+ */
+class TargetSink : public ChunkSink
+{
+private:
+    shared_ptr<SinkTarget> _target;
+    double                 _stallSeconds;
+
+public:
+    explicit TargetSink(shared_ptr<SinkTarget> const& target):
+        _target(target),
+        _stallSeconds(0)
+    {}
+
+    virtual uint64_t consume(ConstChunk const& chunk)
+    {
+        _stallSeconds += _target->write(chunk.getAttributeDesc().getId(), chunk.getFirstPosition(false), chunk.getConstData(), chunk.getSize());
+        return 0;
+    }
+
+    virtual double takeStallSeconds()
+    {
+        double const stall = _stallSeconds;
+        _stallSeconds = 0;
+        return stall;
+    }
+};
+
+/*
+ * consume_rate: hand each chunk, once the sink underneath is done with it, to the instance's
+ * emulated consumer. The time the consumer makes the worker wait counts as a sink stall.
+ */
+class ThrottledSink : public ChunkSink
+{
+private:
+    std::unique_ptr<ChunkSink> _sink;
+    TokenBucket&               _bucket;
+    double                     _stallSeconds;
+
+public:
+    ThrottledSink(std::unique_ptr<ChunkSink> sink, TokenBucket& bucket):
+        _sink(std::move(sink)),
+        _bucket(bucket),
+        _stallSeconds(0)
+    {}
+
+    virtual uint64_t consume(ConstChunk const& chunk)
+    {
+        uint64_t const digest = _sink->consume(chunk);
+        _stallSeconds += _bucket.admit(chunk.getSize());
+        return digest;
+    }
+
+    virtual double takeStallSeconds()
+    {
+        double const stall = _stallSeconds + _sink->takeStallSeconds();
+        _stallSeconds = 0;
+        return stall;
+    }
+
+    virtual void finish()
+    {
+        _sink->finish();
+    }
+};
+
+inline std::unique_ptr<ChunkSink> makeUnthrottledSink(Settings const& settings, shared_ptr<SinkTarget> const& target, ThreadSummary& threadSummary, ThreadArena& arena)
+{
+    if(settings.batchflag())
+    {
+        return std::unique_ptr<ChunkSink>(new BatchSink(settings.batchBytes(), threadSummary));
+    }
+    switch(settings.accessType())
+    {
+    case ACCESS_RAW:    break;
+    case ACCESS_CELL:   return std::unique_ptr<ChunkSink>(new CellSink());
+    case ACCESS_TILE:   return std::unique_ptr<ChunkSink>(new TileSink());
+    }
+    switch(settings.sinkType())
+    {
+    case SINK_NONE:     return std::unique_ptr<ChunkSink>(new NoneSink());
+    case SINK_MEMCPY:   return std::unique_ptr<ChunkSink>(new MemcpySink(arena));
+    case SINK_CHECKSUM: return std::unique_ptr<ChunkSink>(new ChecksumSink());
+    case SINK_DECODE:   return std::unique_ptr<ChunkSink>(new DecodeSink(arena));
+    case SINK_SHM:
+    case SINK_FILE:     return std::unique_ptr<ChunkSink>(new TargetSink(target));
+    }
+    throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "unknown sink";
+}
+
+/*
+ * target is only used, and must be set, with sink=shm and sink=file; bucket likewise with
+ * consume_rate. Batches are counted into threadSummary, and staging buffers come from arena.
+ */
+inline std::unique_ptr<ChunkSink> makeSink(Settings const& settings, shared_ptr<SinkTarget> const& target, TokenBucket* bucket, ThreadSummary& threadSummary, ThreadArena& arena)
+{
+    std::unique_ptr<ChunkSink> sink = makeUnthrottledSink(settings, target, threadSummary, arena);
+    if(settings.consumeRateflag())
+    {
+        return std::unique_ptr<ChunkSink>(new ThrottledSink(std::move(sink), *bucket));
+    }
+    return sink;
+}
+
+} } //namespaces
+
+#endif //pull_sinks
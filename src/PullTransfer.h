@@ -0,0 +1,252 @@
+/*
+**
+* BEGIN_COPYRIGHT
+*
+* Copyright (C) 2008-2016 SciDB, Inc.
+* All Rights Reserved.
+*
+* Pull is a plugin for SciDB, an Open Source Array DBMS maintained
+* by Paradigm4. See http://www.paradigm4.com/
+*
+* Pull is free software: you can redistribute it and/or modify
+* it under the terms of the AFFERO GNU General Public License as published by
+* the Free Software Foundation.
+*
+* summarize is distributed "AS-IS" AND WITHOUT ANY WARRANTY OF ANY KIND,
+* INCLUDING ANY IMPLIED WARRANTY OF MERCHANTABILITY,
+* NON-INFRINGEMENT, OR FITNESS FOR A PARTICULAR PURPOSE. See
+* the AFFERO GNU General Public License for the complete license terms.
+*
+* You should have received a copy of the AFFERO GNU General Public License
+* along with summarize.  If not, see <http://www.gnu.org/licenses/agpl-3.0.html>
+*
+* END_COPYRIGHT
+*/
+
+#ifndef PULL_TRANSFER
+#define PULL_TRANSFER
+
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+#include <query/Operator.h>
+#include <array/Array.h>
+#include <util/Network.h>
+
+#include "PullSettings.h"
+
+namespace scidb
+{
+namespace pull
+{
+
+/*
+ * Ships every locally stored chunk to a peer instance and receives whatever the peers ship here,
+ * in lock-step rounds. Each round a sender ships one chunk to its target, every receiver takes
+ * one message from each of its sources and acknowledges it, and the sender waits for that
+ * acknowledgement before the next round. So at most one chunk per link is in flight and no
+ * instance can run ahead and pile buffers up on a slow peer.
+ *
+ * With a fixed target every other instance ships to it and the target only receives. In a ring
+ * instance i ships to i+1 and receives from i-1.
+ */
+class ChunkTransfer
+{
+private:
+    typedef std::chrono::high_resolution_clock Clock;
+
+    enum MessageKind
+    {
+        MSG_CHUNK,
+        MSG_LAST,      //the sender has no more chunks; not acknowledged
+        MSG_ACK
+    };
+
+    struct MessageHeader
+    {
+        uint32_t kind;
+        uint32_t att;
+        uint64_t payloadSize;
+    };
+
+    shared_ptr<Query>&        _query;
+    Clock::time_point const   _start;
+    vector<LinkStats>&        _links;
+    bool                      _sending;
+    InstanceID                _target;
+    vector<InstanceID>        _sources;
+
+    double secondsSince() const
+    {
+        return std::chrono::duration_cast<std::chrono::duration<double> >(Clock::now() - _start).count();
+    }
+
+    void send(InstanceID const peer, MessageKind const kind, AttributeID const att, void const* payload, size_t const size)
+    {
+        double const sendStart = secondsSince();
+        shared_ptr<SharedBuffer> buf(new MemoryBuffer(NULL, sizeof(MessageHeader) + size));
+        MessageHeader* header = (MessageHeader*) buf->getData();
+        header->kind        = kind;
+        header->att         = att;
+        header->payloadSize = size;
+        if(size > 0)
+        {
+            memcpy(header + 1, payload, size);
+        }
+        BufSend(peer, buf, _query);
+        double const sendEnd = secondsSince();
+        LinkStats& link = _links[peer];
+        link.sendSeconds += sendEnd - sendStart;
+        if(kind == MSG_CHUNK)
+        {
+            link.sentBytes += size;
+            ++link.sentMessages;
+        }
+        link.touch(sendStart, sendEnd);
+    }
+
+    /*
+     * Wait for the next message from peer. Returns its kind.
+     */
+    MessageKind receive(InstanceID const peer)
+    {
+        double const receiveStart = secondsSince();
+        shared_ptr<SharedBuffer> buf = BufReceive(peer, _query);
+        double const receiveEnd = secondsSince();
+        MessageHeader header;
+        if(buf->getSize() < sizeof(MessageHeader))
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "truncated transfer message";
+        }
+        memcpy(&header, buf->getConstData(), sizeof(MessageHeader));
+        if(header.kind > MSG_ACK || header.payloadSize != buf->getSize() - sizeof(MessageHeader))
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "corrupt transfer message";
+        }
+        LinkStats& link = _links[peer];
+        link.receiveSeconds += receiveEnd - receiveStart;
+        if(header.kind == MSG_CHUNK)
+        {
+            link.receivedBytes += header.payloadSize;
+            ++link.receivedMessages;
+        }
+        link.touch(receiveStart, receiveEnd);
+        return (MessageKind) header.kind;
+    }
+
+    void expect(InstanceID const peer, MessageKind const kind)
+    {
+        if(receive(peer) != kind)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "transfer peers out of step";
+        }
+    }
+
+public:
+    ChunkTransfer(Settings const& settings,
+                  shared_ptr<Query>& query,
+                  Clock::time_point const& start,
+                  vector<LinkStats>& links):
+        _query(query),
+        _start(start),
+        _links(links),
+        _sending(true),
+        _target(0)
+    {
+        InstanceID const myId     = query->getInstanceID();
+        size_t const numInstances = query->getInstancesCount();
+        _links.assign(numInstances, LinkStats());
+        if(settings.transferTarget() == Settings::TRANSFER_RING)
+        {
+            _target = (myId + 1) % numInstances;
+            _sources.push_back((myId + numInstances - 1) % numInstances);
+        }
+        else if((InstanceID) settings.transferTarget() != myId)
+        {
+            _target = settings.transferTarget();
+        }
+        else
+        {
+            _sending = false;
+            for(InstanceID i = 0; i<numInstances; ++i)
+            {
+                if(i != myId)
+                {
+                    _sources.push_back(i);
+                }
+            }
+        }
+    }
+
+    /*
+     * Ship the chunks of every attribute of inputArray, in storage order, until every link
+     * touching this instance is closed.
+     */
+    void run(shared_ptr<Array> const& inputArray)
+    {
+        size_t const numAtts = inputArray->getArrayDesc().getAttributes().size();
+        AttributeID att = 0;
+        shared_ptr<ConstArrayIterator> iaiter = inputArray->getConstIterator(att);
+        vector<bool> open(_sources.size(), true);
+        size_t numOpen = _sources.size();
+        while(_sending || numOpen > 0)
+        {
+            bool shipped = false;
+            if(_sending)
+            {
+                while(iaiter->end() && att+1 < numAtts)
+                {
+                    iaiter = inputArray->getConstIterator(++att);
+                }
+                if(!iaiter->end())
+                {
+                    {
+                        shared_ptr<ConstChunkIterator> iciter = iaiter->getChunk().getConstIterator(ConstChunkIterator::IGNORE_OVERLAPS | ConstChunkIterator::IGNORE_EMPTY_CELLS);
+                        ConstChunk const& chunk = iciter->getChunk();
+                        PinBuffer pinScope(chunk);
+                        send(_target, MSG_CHUNK, att, chunk.getConstData(), chunk.getSize());
+                    }
+                    ++(*iaiter);
+                    shipped = true;
+                }
+                else
+                {
+                    send(_target, MSG_LAST, 0, NULL, 0);
+                    _sending = false;
+                }
+            }
+            for(size_t s = 0; s<_sources.size(); ++s)
+            {
+                if(!open[s])
+                {
+                    continue;
+                }
+                MessageKind const kind = receive(_sources[s]);
+                if(kind == MSG_LAST)
+                {
+                    open[s] = false;
+                    --numOpen;
+                }
+                else if(kind == MSG_CHUNK)
+                {
+                    send(_sources[s], MSG_ACK, 0, NULL, 0);
+                }
+                else
+                {
+                    throw SYSTEM_EXCEPTION(SCIDB_SE_INTERNAL, SCIDB_LE_ILLEGAL_OPERATION) << "transfer peers out of step";
+                }
+            }
+            if(shipped)
+            {
+                expect(_target, MSG_ACK);
+            }
+        }
+    }
+};
+
+} } //namespaces
+
+#endif //pull_transfer
@@ -0,0 +1,238 @@
+/*
+**
+* BEGIN_COPYRIGHT
+*
+* Copyright (C) 2008-2016 SciDB, Inc.
+* All Rights Reserved.
+*
+* Pull is a plugin for SciDB, an Open Source Array DBMS maintained
+* by Paradigm4. See http://www.paradigm4.com/
+*
+* Pull is free software: you can redistribute it and/or modify
+* it under the terms of the AFFERO GNU General Public License as published by
+* the Free Software Foundation.
+*
+* summarize is distributed "AS-IS" AND WITHOUT ANY WARRANTY OF ANY KIND,
+* INCLUDING ANY IMPLIED WARRANTY OF MERCHANTABILITY,
+* NON-INFRINGEMENT, OR FITNESS FOR A PARTICULAR PURPOSE. See
+* the AFFERO GNU General Public License for the complete license terms.
+*
+* You should have received a copy of the AFFERO GNU General Public License
+* along with summarize.  If not, see <http://www.gnu.org/licenses/agpl-3.0.html>
+*
+* END_COPYRIGHT
+*/
+
+/*
+ * A stand-in for the process that takes chunks off pull(..., 'sink=shm:<name>'): it drains the
+ * shared-memory ring of one instance and reports how fast it could. Every payload word is
+ * folded into a checksum, so the bytes are really read on this side.
+ *
+ * Start it before the query, with the ring's full name, <name>.<instance id>:
+ *
+ *   pull_shm_consumer mydata.0 &
+ *   iquery -aq "pull(temp, 'sink=shm:mydata')"
+ *
+ * It waits for the ring to appear and exits once the query has closed it and it is drained. A
+ * ring left behind by a query that died is dropped as soon as the next query replaces it.
+ */
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ShmRing.h"
+
+using namespace scidb::pull;
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsBetween(Clock::time_point const& start, Clock::time_point const& end)
+{
+    return std::chrono::duration<double>(end - start).count();
+}
+
+/*
+ * Map the ring once the producer has created and initialized it, passing over retired and
+ * closed ones.
+ */
+static ShmRingHeader* attach(std::string const& name)
+{
+    for(;;)
+    {
+        int fd = -1;
+        while((fd = shm_open(name.c_str(), O_RDWR, 0)) < 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ShmRingHeader* header = NULL;
+        size_t segmentSize = 0;
+        while(header == NULL)
+        {
+            struct stat st;
+            if(fstat(fd, &st) == 0 && st.st_size > (off_t) SHM_HEADER_SIZE)
+            {
+                void* const segment = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                if(segment == MAP_FAILED)
+                {
+                    perror("mmap");
+                    close(fd);
+                    return NULL;
+                }
+                header = (ShmRingHeader*) segment;
+                segmentSize = st.st_size;
+            }
+            else
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        close(fd);
+        while(header->magic.load(std::memory_order_acquire) != SHM_MAGIC && !header->retired.load(std::memory_order_acquire))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        //a live ring waits for its consumer, so one closed before we came is left over too
+        if(!header->retired.load(std::memory_order_acquire) && !header->closed.load(std::memory_order_acquire))
+        {
+            header->consumers.fetch_add(1);
+            return header;
+        }
+        munmap(header, segmentSize);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+static uint64_t fold(char const* data, uint64_t const size)
+{
+    uint64_t sum = 0;
+    uint64_t const numWords = size / sizeof(uint64_t);
+    for(uint64_t w = 0; w<numWords; ++w)
+    {
+        uint64_t word;
+        memcpy(&word, data + w * sizeof(uint64_t), sizeof(word));
+        sum += word;
+    }
+    return sum;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc != 2)
+    {
+        fprintf(stderr, "usage: %s <ring name, e.g. mydata.0>\n", argv[0]);
+        return 2;
+    }
+    std::string const name = std::string("/") + argv[1];
+    ShmRingHeader* header = attach(name);
+    if(header == NULL)
+    {
+        return 1;
+    }
+    char const* ring = (char const*) header + SHM_HEADER_SIZE;
+    uint64_t capacity = header->capacity;
+
+    std::vector<uint64_t> chunks;
+    std::vector<uint64_t> bytes;
+    uint64_t checksum = 0;
+    double idleSeconds = 0;
+    Clock::time_point start;
+    bool started = false;
+    uint64_t tail = header->tail.load(std::memory_order_relaxed);
+    for(;;)
+    {
+        uint64_t const head = header->head.load(std::memory_order_acquire);
+        if(tail == head)
+        {
+            if(header->retired.load(std::memory_order_acquire))
+            {
+                //left over from a query that died; what it held wasn't this query's
+                fprintf(stderr, "%s was replaced by a new query's ring; starting over on that one\n", argv[1]);
+                munmap(header, SHM_HEADER_SIZE + capacity);
+                header = attach(name);
+                if(header == NULL)
+                {
+                    return 1;
+                }
+                ring     = (char const*) header + SHM_HEADER_SIZE;
+                capacity = header->capacity;
+                chunks.clear();
+                bytes.clear();
+                checksum    = 0;
+                idleSeconds = 0;
+                started     = false;
+                tail = header->tail.load(std::memory_order_relaxed);
+                continue;
+            }
+            if(header->closed.load(std::memory_order_acquire) && header->head.load(std::memory_order_acquire) == tail)
+            {
+                break;
+            }
+            Clock::time_point const idleStart = Clock::now();
+            std::this_thread::yield();
+            if(started)
+            {
+                idleSeconds += secondsBetween(idleStart, Clock::now());
+            }
+            continue;
+        }
+        if(!started)
+        {
+            start = Clock::now();
+            started = true;
+        }
+        while(tail < head)
+        {
+            uint64_t const offset = tail % capacity;
+            if(capacity - offset < sizeof(ShmRecord))
+            {
+                tail += capacity - offset;
+                continue;
+            }
+            ShmRecord record;
+            memcpy(&record, ring + offset, sizeof(record));
+            if(record.att == SHM_WRAP)
+            {
+                tail += capacity - offset;
+                continue;
+            }
+            char const* const payload = ring + offset + sizeof(record) + record.numDims * sizeof(int64_t);
+            checksum += fold(payload, record.payloadSize);
+            if(chunks.size() <= record.att)
+            {
+                chunks.resize(record.att + 1, 0);
+                bytes.resize(record.att + 1, 0);
+            }
+            ++chunks[record.att];
+            bytes[record.att] += record.payloadSize;
+            tail += shmRecordSize(record.numDims, record.payloadSize);
+        }
+        header->tail.store(tail, std::memory_order_release);
+    }
+    double const seconds = started ? secondsBetween(start, Clock::now()) : 0;
+    uint64_t totalChunks = 0;
+    uint64_t totalBytes = 0;
+    printf("attid,chunks,bytes\n");
+    for(size_t a = 0; a<chunks.size(); ++a)
+    {
+        if(chunks[a] > 0)
+        {
+            printf("%zu,%llu,%llu\n", a, (unsigned long long) chunks[a], (unsigned long long) bytes[a]);
+            totalChunks += chunks[a];
+            totalBytes  += bytes[a];
+        }
+    }
+    printf("total chunks %llu, bytes %llu, seconds %.6f, bytes per second %.0f, idle seconds %.6f, checksum %016llx\n",
+           (unsigned long long) totalChunks, (unsigned long long) totalBytes, seconds,
+           seconds > 0 ? totalBytes / seconds : 0, idleSeconds, (unsigned long long) checksum);
+    munmap(header, SHM_HEADER_SIZE + capacity);
+    return 0;
+}
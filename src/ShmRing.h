@@ -0,0 +1,86 @@
+/*
+**
+* BEGIN_COPYRIGHT
+*
+* Copyright (C) 2008-2016 SciDB, Inc.
+* All Rights Reserved.
+*
+* Pull is a plugin for SciDB, an Open Source Array DBMS maintained
+* by Paradigm4. See http://www.paradigm4.com/
+*
+* Pull is free software: you can redistribute it and/or modify
+* it under the terms of the AFFERO GNU General Public License as published by
+* the Free Software Foundation.
+*
+* summarize is distributed "AS-IS" AND WITHOUT ANY WARRANTY OF ANY KIND,
+* INCLUDING ANY IMPLIED WARRANTY OF MERCHANTABILITY,
+* NON-INFRINGEMENT, OR FITNESS FOR A PARTICULAR PURPOSE. See
+* the AFFERO GNU General Public License for the complete license terms.
+*
+* You should have received a copy of the AFFERO GNU General Public License
+* along with summarize.  If not, see <http://www.gnu.org/licenses/agpl-3.0.html>
+*
+* END_COPYRIGHT
+*/
+
+#ifndef SHM_RING
+#define SHM_RING
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The layout of the shared-memory ring that sink=shm:<name> fills and pull_shm_consumer drains.
+ * Both sides include this file, so it only uses the standard library.
+ *
+ * The segment is a ShmRingHeader followed by capacity bytes of ring. head counts every byte the
+ * producer has published and tail every byte the consumer has released; both only grow, so the
+ * fill level is head - tail and a position in the ring is the count modulo capacity. Each chunk
+ * is one record: a ShmRecord, numDims chunk coordinates, and the raw payload, padded to 8 bytes.
+ * A record never wraps around the end of the ring. When it wouldn't fit, the producer skips to
+ * the start and leaves an SHM_WRAP record behind if there is room for one; with less room than a
+ * ShmRecord left, the consumer skips on its own.
+ *
+ * A consumer counts itself in consumers once attached, and the producer waits for one before it
+ * publishes anything. A producer that finds a ring of the same name left over, say by a query
+ * that died, sets retired on it before replacing it, so that a consumer stuck on the old ring
+ * knows to attach to the new one.
+ */
+namespace scidb
+{
+namespace pull
+{
+
+static const uint64_t SHM_MAGIC       = 0x676e6952516c6c50ULL;   //"PllQRing"
+static const size_t   SHM_HEADER_SIZE = 4096;
+static const uint32_t SHM_WRAP        = 0xffffffff;
+
+struct ShmRingHeader
+{
+    std::atomic<uint64_t> magic;        //set last, once the rest is initialized
+    uint64_t              capacity;
+    std::atomic<uint32_t> closed;       //the producer is done; what's left in the ring is all there is
+    std::atomic<uint32_t> consumers;    //number of consumers attached
+    std::atomic<uint32_t> retired;      //a newer producer replaced this ring under its name
+    char                  pad0[36];
+    std::atomic<uint64_t> head;         //written by the producer only, on its own cache line
+    char                  pad1[56];
+    std::atomic<uint64_t> tail;         //written by the consumer only
+};
+
+struct ShmRecord
+{
+    uint32_t att;                       //attribute id, or SHM_WRAP
+    uint32_t numDims;
+    uint64_t payloadSize;
+};
+
+inline uint64_t shmRecordSize(uint32_t const numDims, uint64_t const payloadSize)
+{
+    return (sizeof(ShmRecord) + numDims * sizeof(int64_t) + payloadSize + 7) & ~((uint64_t) 7);
+}
+
+} } //namespaces
+
+#endif //shm_ring
@@ -0,0 +1,253 @@
+/*
+**
+* BEGIN_COPYRIGHT
+*
+* Copyright (C) 2008-2016 SciDB, Inc.
+* All Rights Reserved.
+*
+* Pull is a plugin for SciDB, an Open Source Array DBMS maintained
+* by Paradigm4. See http://www.paradigm4.com/
+*
+* Pull is free software: you can redistribute it and/or modify
+* it under the terms of the AFFERO GNU General Public License as published by
+* the Free Software Foundation.
+*
+* summarize is distributed "AS-IS" AND WITHOUT ANY WARRANTY OF ANY KIND,
+* INCLUDING ANY IMPLIED WARRANTY OF MERCHANTABILITY,
+* NON-INFRINGEMENT, OR FITNESS FOR A PARTICULAR PURPOSE. See
+* the AFFERO GNU General Public License for the complete license terms.
+*
+* You should have received a copy of the AFFERO GNU General Public License
+* along with summarize.  If not, see <http://www.gnu.org/licenses/agpl-3.0.html>
+*
+* END_COPYRIGHT
+*/
+
+#ifndef STORAGE_FILES
+#define STORAGE_FILES
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <system/Config.h>
+
+#include "PullSettings.h"
+
+namespace scidb
+{
+namespace pull
+{
+
+/*
+ * The files this instance keeps array data in. The storage option names the instance's storage
+ * description file; 16.x keeps one data file per array next to it, under datastores/.
+ */
+inline vector<string> listStorageFiles()
+{
+    string const storage = Config::getInstance()->getOption<string>(CONFIG_STORAGE);
+    size_t const slash = storage.find_last_of('/');
+    string const dataDir = (slash == string::npos ? string(".") : storage.substr(0, slash)) + "/datastores";
+    vector<string> files;
+    DIR* dir = opendir(dataDir.c_str());
+    if(dir == NULL)
+    {
+        LOG4CXX_WARN(logger, "pull: can't list storage directory " << dataDir);
+        return files;
+    }
+    for(struct dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir))
+    {
+        string const path = dataDir + "/" + entry->d_name;
+        struct stat st;
+        if(stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+        {
+            files.push_back(path);
+        }
+    }
+    closedir(dir);
+    return files;
+}
+
+/*
+ * Drop the files' pages from the OS page cache. Dirty pages can't be dropped, so they are
+ * written back first. Returns the number of files evicted.
+ */
+inline size_t evictFromPageCache(vector<string> const& files)
+{
+    size_t evicted = 0;
+    for(size_t f = 0; f<files.size(); ++f)
+    {
+        int const fd = open(files[f].c_str(), O_RDONLY);
+        if(fd < 0)
+        {
+            continue;
+        }
+        fdatasync(fd);
+        if(posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0)
+        {
+            ++evicted;
+        }
+        close(fd);
+    }
+    return evicted;
+}
+
+/*
+ * The data files of one array, if this instance's datastores name them by the array's UAID
+ * (<uaid>.data and its free list); otherwise none.
+ */
+inline vector<string> listArrayFiles(ArrayUAID const uaid)
+{
+    vector<string> const files = listStorageFiles();
+    vector<string> arrayFiles;
+    std::ostringstream prefix;
+    prefix << "/" << uaid << ".";
+    for(size_t f = 0; f<files.size(); ++f)
+    {
+        if(files[f].find(prefix.str()) != string::npos)
+        {
+            arrayFiles.push_back(files[f]);
+        }
+    }
+    return arrayFiles;
+}
+
+/*
+ * engine=direct: the storage files read sequentially with O_DIRECT, the fastest the device can
+ * hand the bytes over with no SciDB code in the way. The files are cut into BLOCK_SIZE blocks
+ * and queueDepth threads each keep one pread() in flight on their own aligned buffer, taking
+ * the next block when it lands. File systems that refuse O_DIRECT are read through the page
+ * cache instead, which is logged.
+ */
+class DirectReader
+{
+private:
+    static const size_t BLOCK_SIZE = 4 * 1024 * 1024;
+    static const size_t ALIGNMENT  = 4096;
+
+    struct Block
+    {
+        int   fd;
+        off_t offset;
+    };
+
+    vector<int>          _fds;
+    vector<Block>        _blocks;
+    std::atomic<size_t>  _nextBlock;
+    std::atomic<uint64_t> _bytesRead;
+    std::atomic<size_t>  _failures;
+
+    DirectReader(DirectReader const&);
+    DirectReader& operator=(DirectReader const&);
+
+    void openFiles(vector<string> const& files)
+    {
+        for(size_t f = 0; f<files.size(); ++f)
+        {
+            int fd = open(files[f].c_str(), O_RDONLY | O_DIRECT);
+            if(fd < 0 && errno == EINVAL)
+            {
+                LOG4CXX_WARN(logger, "pull: " << files[f] << " doesn't support O_DIRECT; reading it through the page cache");
+                fd = open(files[f].c_str(), O_RDONLY);
+            }
+            if(fd < 0)
+            {
+                LOG4CXX_WARN(logger, "pull: can't open storage file " << files[f]);
+                continue;
+            }
+            _fds.push_back(fd);
+            struct stat st;
+            if(fstat(fd, &st) != 0)
+            {
+                continue;
+            }
+            for(off_t offset = 0; offset < st.st_size; offset += BLOCK_SIZE)
+            {
+                Block block;
+                block.fd     = fd;
+                block.offset = offset;
+                _blocks.push_back(block);
+            }
+        }
+    }
+
+    void readBlocks()
+    {
+        void* buffer = NULL;
+        if(posix_memalign(&buffer, ALIGNMENT, BLOCK_SIZE) != 0)
+        {
+            ++_failures;
+            return;
+        }
+        for(size_t b = _nextBlock++; b < _blocks.size(); b = _nextBlock++)
+        {
+            ssize_t const got = pread(_blocks[b].fd, buffer, BLOCK_SIZE, _blocks[b].offset);
+            if(got < 0)
+            {
+                ++_failures;
+                continue;
+            }
+            _bytesRead += got;
+        }
+        ::free(buffer);
+    }
+
+public:
+    explicit DirectReader(vector<string> const& files):
+        _nextBlock(0),
+        _bytesRead(0),
+        _failures(0)
+    {
+        openFiles(files);
+    }
+
+    ~DirectReader()
+    {
+        for(size_t f = 0; f<_fds.size(); ++f)
+        {
+            close(_fds[f]);
+        }
+    }
+
+    /*
+     * Read every block once with queueDepth reads in flight. Returns the wall time taken.
+     */
+    double run(size_t const queueDepth)
+    {
+        _nextBlock = 0;
+        _bytesRead = 0;
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+        vector<std::thread> readers;
+        for(size_t q = 0; q<queueDepth; ++q)
+        {
+            readers.push_back(std::thread(&DirectReader::readBlocks, this));
+        }
+        for(size_t q = 0; q<readers.size(); ++q)
+        {
+            readers[q].join();
+        }
+        double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if(_failures > 0)
+        {
+            LOG4CXX_WARN(logger, "pull: " << _failures << " direct reads failed");
+        }
+        return seconds;
+    }
+
+    uint64_t bytesRead() const
+    {
+        return _bytesRead;
+    }
+};
+
+} } //namespaces
+
+#endif //storage_files
@@ -0,0 +1,217 @@
+/*
+**
+* BEGIN_COPYRIGHT
+*
+* Copyright (C) 2008-2016 SciDB, Inc.
+* All Rights Reserved.
+*
+* Pull is a plugin for SciDB, an Open Source Array DBMS maintained
+* by Paradigm4. See http://www.paradigm4.com/
+*
+* Pull is free software: you can redistribute it and/or modify
+* it under the terms of the AFFERO GNU General Public License as published by
+* the Free Software Foundation.
+*
+* summarize is distributed "AS-IS" AND WITHOUT ANY WARRANTY OF ANY KIND,
+* INCLUDING ANY IMPLIED WARRANTY OF MERCHANTABILITY,
+* NON-INFRINGEMENT, OR FITNESS FOR A PARTICULAR PURPOSE. See
+* the AFFERO GNU General Public License for the complete license terms.
+*
+* You should have received a copy of the AFFERO GNU General Public License
+* along with summarize.  If not, see <http://www.gnu.org/licenses/agpl-3.0.html>
+*
+* END_COPYRIGHT
+*/
+
+#ifndef THREAD_ARENA
+#define THREAD_ARENA
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include "PullSettings.h"
+#include "NumaTopology.h"
+
+namespace scidb
+{
+namespace pull
+{
+
+/*
+ * Backing memory for one worker's staging buffers. Released blocks go to a free list and are
+ * handed out again, so once the buffers have grown to the largest chunk the read loop makes no
+ * more trips to the system allocator; allocations() counts the trips that were made. A request
+ * that no free block fits means the buffers have outgrown them, and the free blocks go back to
+ * the system rather than sit on the list. With huge pages, blocks come in 2MB multiples mapped
+ * with MAP_HUGETLB, or, where no huge pages are reserved, mapped normally and advised to
+ * transparent huge pages. With a memory policy, blocks are mapped and bound to their NUMA nodes
+ * before anything touches them. Not thread-safe.
+ */
+class ThreadArena
+{
+private:
+    static const size_t PAGE_SIZE      = 4096;
+    static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    struct Block
+    {
+        char*  data;
+        size_t size;
+    };
+
+    bool const    _hugePages;
+    int const     _policy;          //MPOL_DEFAULT to leave placement to first touch
+    uint64_t const _nodeMask;
+    vector<Block> _owned;
+    vector<Block> _free;
+    uint64_t      _allocations;
+    uint64_t      _allocatedBytes;
+
+    ThreadArena(ThreadArena const&);
+    ThreadArena& operator=(ThreadArena const&);
+
+    bool mapped() const
+    {
+        return _hugePages || _policy != MPOL_DEFAULT;
+    }
+
+    char* map(size_t const size)
+    {
+        if(mapped())
+        {
+            void* data = _hugePages ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0) : MAP_FAILED;
+            if(data == MAP_FAILED)
+            {
+                data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if(data != MAP_FAILED && _hugePages)
+                {
+                    madvise(data, size, MADV_HUGEPAGE);
+                }
+            }
+            if(data != MAP_FAILED && _policy != MPOL_DEFAULT)
+            {
+                placeMemory(data, size, _policy, _nodeMask);
+            }
+            return data == MAP_FAILED ? NULL : (char*) data;
+        }
+        void* data = NULL;
+        return posix_memalign(&data, PAGE_SIZE, size) == 0 ? (char*) data : NULL;
+    }
+
+    void unmap(Block const& block)
+    {
+        if(mapped())
+        {
+            munmap(block.data, block.size);
+        }
+        else
+        {
+            ::free(block.data);
+        }
+    }
+
+    /*
+     * Return every free block to the system.
+     */
+    void dropFree()
+    {
+        for(size_t b = 0; b<_free.size(); ++b)
+        {
+            for(size_t o = 0; o<_owned.size(); ++o)
+            {
+                if(_owned[o].data == _free[b].data)
+                {
+                    _owned[o] = _owned.back();
+                    _owned.pop_back();
+                    break;
+                }
+            }
+            unmap(_free[b]);
+        }
+        _free.clear();
+    }
+
+public:
+    /*
+     * policy and nodeMask are as for mbind.
+     */
+    explicit ThreadArena(bool const hugePages = false, int const policy = MPOL_DEFAULT, uint64_t const nodeMask = 0):
+        _hugePages(hugePages),
+        _policy(policy),
+        _nodeMask(nodeMask),
+        _allocations(0),
+        _allocatedBytes(0)
+    {}
+
+    ~ThreadArena()
+    {
+        for(size_t b = 0; b<_owned.size(); ++b)
+        {
+            unmap(_owned[b]);
+        }
+    }
+
+    /*
+     * A block of at least size bytes, page-aligned. size is updated to the block's real size.
+     * The smallest free block that fits is reused; if none fits, the free blocks are
+     * released before anything new is mapped.
+     */
+    char* allocate(size_t& size)
+    {
+        size_t best = _free.size();
+        for(size_t b = 0; b<_free.size(); ++b)
+        {
+            if(_free[b].size >= size && (best == _free.size() || _free[b].size < _free[best].size))
+            {
+                best = b;
+            }
+        }
+        if(best < _free.size())
+        {
+            Block const block = _free[best];
+            _free[best] = _free.back();
+            _free.pop_back();
+            size = block.size;
+            return block.data;
+        }
+        //nothing free fits, so the buffers have outgrown all of it
+        dropFree();
+        size_t const granule = _hugePages ? HUGE_PAGE_SIZE : PAGE_SIZE;
+        size = ((size + granule - 1) / granule) * granule;
+        char* const data = map(size);
+        if(data == NULL)
+        {
+            throw SYSTEM_EXCEPTION(SCIDB_SE_NO_MEMORY, SCIDB_LE_MEMORY_ALLOCATION_ERROR) << "thread arena";
+        }
+        Block const block = { data, size };
+        _owned.push_back(block);
+        _free.reserve(_owned.size());
+        ++_allocations;
+        _allocatedBytes += size;
+        return data;
+    }
+
+    void release(char* const data, size_t const size)
+    {
+        if(data != NULL)
+        {
+            Block const block = { data, size };
+            _free.push_back(block);
+        }
+    }
+
+    uint64_t allocations() const
+    {
+        return _allocations;
+    }
+
+    uint64_t allocatedBytes() const
+    {
+        return _allocatedBytes;
+    }
+};
+
+} } //namespaces
+
+#endif //thread_arena
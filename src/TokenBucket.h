@@ -0,0 +1,128 @@
+/*
+**
+* BEGIN_COPYRIGHT
+*
+* Copyright (C) 2008-2016 SciDB, Inc.
+* All Rights Reserved.
+*
+* Pull is a plugin for SciDB, an Open Source Array DBMS maintained
+* by Paradigm4. See http://www.paradigm4.com/
+*
+* Pull is free software: you can redistribute it and/or modify
+* it under the terms of the AFFERO GNU General Public License as published by
+* the Free Software Foundation.
+*
+* summarize is distributed "AS-IS" AND WITHOUT ANY WARRANTY OF ANY KIND,
+* INCLUDING ANY IMPLIED WARRANTY OF MERCHANTABILITY,
+* NON-INFRINGEMENT, OR FITNESS FOR A PARTICULAR PURPOSE. See
+* the AFFERO GNU General Public License for the complete license terms.
+*
+* You should have received a copy of the AFFERO GNU General Public License
+* along with summarize.  If not, see <http://www.gnu.org/licenses/agpl-3.0.html>
+*
+* END_COPYRIGHT
+*/
+
+#ifndef TOKEN_BUCKET
+#define TOKEN_BUCKET
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <stdint.h>
+
+namespace scidb
+{
+namespace pull
+{
+
+/*
+ * A consumer that takes data at a fixed rate, such as an accelerator, emulated as a token bucket
+ * in its virtual-scheduling form: the consumer is busy until freeAt, each chunk moves freeAt on by
+ * bytes/rate plus a fixed compute delay, and a producer may run at most BURST_SECONDS ahead of it
+ * (the consumer's input buffer) before it has to wait. When a chunk arrives after freeAt the
+ * consumer sat idle in between, which is counted as starved. Shared by all of an instance's
+ * workers, so the rate is per instance.
+ */
+class TokenBucket
+{
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    double const            _rate;          //bytes per second
+    double const            _delay;         //seconds per chunk
+    Clock::time_point const _start;
+    std::mutex              _mutex;
+    double                  _freeAt;        //seconds since _start
+    double                  _starvedSeconds;
+    uint64_t                _bytes;
+
+    double now() const
+    {
+        return std::chrono::duration<double>(Clock::now() - _start).count();
+    }
+
+public:
+    static constexpr double BURST_SECONDS = 0.01;
+
+    TokenBucket(double const rate, double const delay):
+        _rate(rate),
+        _delay(delay),
+        _start(Clock::now()),
+        _freeAt(0),
+        _starvedSeconds(0),
+        _bytes(0)
+    {}
+
+    /*
+     * Hand a chunk of the given size to the consumer, sleeping while the consumer is more than a
+     * burst behind. Returns the seconds slept.
+     */
+    double admit(uint64_t const bytes)
+    {
+        double wait;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            double const arrival = now();
+            if(_freeAt < arrival)
+            {
+                _starvedSeconds += arrival - _freeAt;
+                _freeAt = arrival;
+            }
+            _freeAt += bytes / _rate + _delay;
+            _bytes  += bytes;
+            wait = std::max(_freeAt - BURST_SECONDS - arrival, 0.0);
+        }
+        if(wait > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+        }
+        return wait;
+    }
+
+    double starvedSeconds()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _starvedSeconds;
+    }
+
+    uint64_t bytesConsumed()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _bytes;
+    }
+
+    /*
+     * From construction until the consumer is done with the last chunk handed to it.
+     */
+    double consumerSeconds()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _freeAt;
+    }
+};
+
+} } //namespaces
+
+#endif //token_bucket
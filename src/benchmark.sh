@@ -14,6 +14,34 @@ rm test.expected
 touch ./test.expected
 
 iquery -o csv:l -aq "pull(zero_to_255)" >> test.out
+iquery -o csv:l -aq "pull(temp, 'threads=4')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'threads=4', 'ranges=4')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'per_attribute=true', 'prefetch=4')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'per_attribute=true', 'breakdown=true')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'per_attribute=true', 'breakdown=true', 'sink=decode')" >> test.out
+iquery -o csv:l -aq "aggregate(pull(temp, 'trace=true'), count(*), max(duration_ns))" >> test.out
+iquery -o csv:l -aq "pull(temp, 'transfer=ring')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'transfer=0')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'sweep=1,2,4,8', 'ranges=8')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'per_attribute=true', 'compress=all')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'per_attribute=true', 'access=cell')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'per_attribute=true', 'access=tile')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'per_attribute=true', 'per_instance=true')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'per_attribute=true', 'counters=true')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'iterations=5', 'cache=cold')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'iterations=5', 'cache=warm')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'per_attribute=true', 'attrs=a,b', 'sample=0.01')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'order=random')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'engine=direct', 'queue_depth=8')" >> test.out
+NUM_INSTANCES=$(iquery -o csv -aq "aggregate(list('instances'), count(*))" | tail -n 1)
+for i in $(seq 0 $((NUM_INSTANCES-1))); do ./pull_shm_consumer bench.$i > /dev/null & done
+iquery -o csv:l -aq "pull(temp, 'per_attribute=true', 'sink=shm:bench')" >> test.out
+wait
+iquery -o csv:l -aq "pull(temp, 'sink=file:/tmp/pull_bench', 'file_direct=true')" >> test.out
+iquery -o csv:l -aq "pull(zero_to_255, 'per_attribute=true', 'batch_bytes=1048576')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'per_attribute=true', 'breakdown=true', 'huge_pages=true')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'threads=4', 'numa=local', 'pin=true')" >> test.out
+iquery -o csv:l -aq "pull(temp, 'threads=4', 'consume_rate=1e9', 'consume_delay=0.0001')" >> test.out
 
 #iquery -o csv:l -aq "aggregate(filter(summarize(between(zero_to_255,0,9)), attid=0), sum(count) as count)" >> test.out
 #iquery -o csv:l -aq "aggregate(filter(summarize(zero_to_255_overlap), attid=0), sum(count) as count)" >> test.out
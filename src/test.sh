@@ -36,6 +36,72 @@ echo "'b',10000000,90000720,10,1000000,1e+06,1000000,9000072,9.00007e+06,9000072
 echo "'c',10000000,800,10,1000000,1e+06,1000000,80,80,80" >> ./test.expected
 echo "'EmptyTag',10000000,480,10,1000000,1e+06,1000000,48,48,48" >> ./test.expected
 
+ninst=$(iquery -o csv -aq "aggregate(list('instances'), count(*) as count)" | tail -n 1)
+
+iquery -o csv:l -aq "project(pull(temp), read_bytes, chunks)" >> test.out
+echo 'read_bytes,chunks' >> ./test.expected
+echo '170002720,40' >> ./test.expected
+
+iquery -o csv:l -aq "project(pull(temp, 'access=cell'), read_bytes, chunks, cells)" >> test.out
+echo 'read_bytes,chunks,cells' >> ./test.expected
+echo '170002720,40,40000000' >> ./test.expected
+
+iquery -o csv:l -aq "project(pull(temp, 'access=tile'), read_bytes, chunks, cells)" >> test.out
+echo 'read_bytes,chunks,cells' >> ./test.expected
+echo '170002720,40,40000000' >> ./test.expected
+
+iquery -o csv:l -aq "project(pull(temp, 'threads=4', 'ranges=4', 'prefetch=2'), read_bytes, chunks)" >> test.out
+echo 'read_bytes,chunks' >> ./test.expected
+echo '170002720,40' >> ./test.expected
+
+iquery -o csv:l -aq "aggregate(pull(temp, 'trace=true'), count(*) as count, sum(bytes) as bytes)" >> test.out
+echo 'count,bytes' >> ./test.expected
+echo '40,170002720' >> ./test.expected
+
+#measured iterations add up; the warmup doesn't count
+iquery -o csv:l -aq "project(pull(temp, 'iterations=2', 'warmup=1'), read_bytes, chunks, iterations)" >> test.out
+echo 'read_bytes,chunks,iterations' >> ./test.expected
+echo '340005440,80,2' >> ./test.expected
+
+#the digest doesn't depend on how the chunks were read, only on what they hold
+digest() { iquery -o csv -aq "project(pull(temp, 'sink=checksum'$1), digest)" | tail -n 1; }
+base=$(digest "")
+for opts in ", 'threads=4'" ", 'ranges=4'" ", 'order=random'" ", 'iterations=3'"; do
+    if [ "$(digest "$opts")" == "$base" ]; then
+        echo "digest matches with$opts" >> test.out
+    else
+        echo "digest differs with$opts" >> test.out
+    fi
+    echo "digest matches with$opts" >> ./test.expected
+done
+
+#the matrix: the corner, the inner cells, the instances' totals and the attributes' totals all add up to the whole array
+natts=4
+iquery -anq "remove(pull_matrix)" > /dev/null 2>&1
+iquery -naq "store(pull(temp, 'per_attribute=true', 'per_instance=true'), pull_matrix)" > /dev/null 2>&1
+iquery -o csv:l -aq "project(between(pull_matrix, $ninst, $natts, $ninst, $natts), read_bytes, chunks)" >> test.out
+iquery -o csv:l -aq "aggregate(between(pull_matrix, 0, 0, $((ninst-1)), $((natts-1))), sum(read_bytes) as read_bytes, sum(chunks) as chunks)" >> test.out
+iquery -o csv:l -aq "aggregate(between(pull_matrix, 0, $natts, $((ninst-1)), $natts), sum(read_bytes) as read_bytes, sum(chunks) as chunks)" >> test.out
+iquery -o csv:l -aq "aggregate(between(pull_matrix, $ninst, 0, $ninst, $((natts-1))), sum(read_bytes) as read_bytes, sum(chunks) as chunks)" >> test.out
+for k in 1 2 3 4; do
+    echo 'read_bytes,chunks' >> ./test.expected
+    echo '170002720,40' >> ./test.expected
+done
+iquery -anq "remove(pull_matrix)" > /dev/null 2>&1
+
+#every link: what one end sent, the other received
+if [ "$ninst" -ge 2 ]; then
+    iquery -anq "remove(pull_links)" > /dev/null 2>&1
+    iquery -naq "store(pull(temp, 'transfer=ring'), pull_links)" > /dev/null 2>&1
+    iquery -o csv:l -aq "aggregate(filter(cross_join(project(pull_links, sent_bytes) as S, project(pull_links, received_bytes) as R), S.inst = R.peer and S.peer = R.inst and S.sent_bytes <> R.received_bytes), count(*) as count)" >> test.out
+    iquery -anq "remove(pull_links)" > /dev/null 2>&1
+else
+    echo 'count' >> test.out
+    echo '0' >> test.out
+fi
+echo 'count' >> ./test.expected
+echo '0' >> ./test.expected
+
 diff test.out test.expected
 exit 0
 